@@ -1,25 +1,344 @@
 import esphome.codegen as cg
 import esphome.config_validation as cv
-from esphome.components import canbus
-from esphome.const import CONF_ID, CONF_UPDATE_INTERVAL
+import esphome.final_validate as fv
+from esphome import automation
+from esphome.components import canbus, sensor
+from esphome.core import CORE
+from esphome.helpers import write_file_if_changed
+from esphome.const import (
+    CONF_ID,
+    CONF_TRIGGER_ID,
+    CONF_UPDATE_INTERVAL,
+    ENTITY_CATEGORY_DIAGNOSTIC,
+    ICON_TIMER,
+    STATE_CLASS_MEASUREMENT,
+    STATE_CLASS_TOTAL_INCREASING,
+    UNIT_MILLISECOND,
+    UNIT_PERCENT,
+)
 
 DEPENDENCIES = ["canbus"]
-AUTO_LOAD = ["canbus"]
+AUTO_LOAD = ["canbus", "sensor"]
+# One instance per PowerStream, each on its own canbus
+MULTI_CONF = True
 
 ef_ps_ns = cg.esphome_ns.namespace("ef_ps")
 EfPsComponent = ef_ps_ns.class_(
     "EfPsComponent", cg.Component
 )
+EfPsMessageTrigger = ef_ps_ns.class_(
+    "EfPsMessageTrigger",
+    automation.Trigger.template(cg.std_vector.template(cg.uint8), cg.uint16),
+)
 
 CONF_CANBUS_ID = "canbus_id"
+CONF_TX_TASK = "tx_task"
+CONF_BUS_BIT_RATE = "bus_bit_rate"
+CONF_BUS_LOAD = "bus_load"
+CONF_BUS_LOAD_PEAK = "bus_load_peak"
+CONF_SEQ_CYCLE_MS = "seq_cycle_ms"
+CONF_SEQ_LATE_MAX_MS = "seq_late_max_ms"
+CONF_SEQ_RESYNCS = "seq_resyncs"
+CONF_RX_TYPE_COUNTERS = "rx_type_counters"
+CONF_MSG_TYPE = "msg_type"
+CONF_TRACKER = "tracker"
+CONF_ON_MESSAGE = "on_message"
+CONF_TELEMETRY = "telemetry"
+CONF_OFFSET = "offset"
+CONF_WIDTH = "width"
+CONF_BIG_ENDIAN = "big_endian"
+CONF_SIGNED = "signed"
+CONF_TX_MESSAGES = "tx_messages"
+CONF_TX_SCHEDULE = "tx_schedule"
+CONF_ACTION = "action"
+CONF_GAP = "gap"
+CONF_CAN_TX_ENABLED = "can_tx_enabled"
+CONF_SERIAL = "serial"
+CONF_VOLTAGE = "voltage"
+CONF_SOC = "soc"
+CONF_TEMPERATURE = "temperature"
+CONF_CHARGE_VOLTAGE = "charge_voltage"
+CONF_ENABLED_MESSAGES = "enabled_messages"
+CONF_TX_LOGGING = "tx_logging"
+CONF_RX_LOGGING = "rx_logging"
+
+# TX messages in TXM_* bit order (tx_schedule.h)
+TX_MESSAGES = ["70", "0B", "4F", "68", "13", "CB", "5C", "24", "8C", "3C"]
+
+# kSeq actions (TxAction A_*) and the message each one sends
+TX_ACTIONS = {
+    "70": "70",
+    "0B_04": "0B",
+    "0B_02": "0B",
+    "0B_05": "0B",
+    "0B_50": "0B",
+    "0B_08": "0B",
+    "4F": "4F",
+    "68": "68",
+    "13": "13",
+    "CB_321": "CB",
+    "CB_141": "CB",
+    "5C": "5C",
+    "CB_150": "CB",
+}
+
+# (action, gap ms); keep in step with kSeq in tx_schedule.h
+DEFAULT_TX_SCHEDULE = [
+    ("70", 25),
+    ("0B_04", 1), ("0B_02", 1), ("0B_05", 1), ("0B_50", 1), ("0B_08", 100),
+    ("4F", 100),
+    ("0B_04", 1), ("0B_02", 1), ("0B_05", 1), ("0B_50", 1), ("0B_08", 100),
+    ("68", 4),
+    ("13", 1),
+    ("CB_321", 1),
+    ("CB_141", 1),
+    ("5C", 1),
+    ("CB_150", 100),
+    ("0B_04", 1), ("0B_02", 1), ("0B_05", 1), ("0B_50", 1), ("0B_08", 200),
+]
+EF_SEQ_MAX_STEPS = 32
+
+# rx_dispatch.h RX_TRACKER_ANY: match every tracker of the msg_type
+RX_TRACKER_ANY = 0x10000
+
+# Protocol counters, e.g. `rx_frames` (total) and `rx_frames_rate` (per s).
+# Index order matches MetricId in metrics.h.
+METRICS = [
+    "rx_frames",
+    "rx_queue_drops",
+    "rx_messages",
+    "rx_reassembly_drops",
+    "rx_timeouts",
+    "rx_crc_errors",
+    "rx_unhandled",
+    "tx_frames",
+    "tx_messages",
+    "tx_reply_drops",
+    "tx_errors",
+]
+
+# Request -> reply latency percentiles, e.g. `c4_reply_latency_p99`.
+# Index order matches RequestType in ecoflow.h.
+REPLY_LATENCY_TYPES = ["c4", "de", "cb"]
+REPLY_LATENCY_PERCENTILES = [50, 99]
+
+LATENCY_SENSOR_SCHEMA = sensor.sensor_schema(
+    unit_of_measurement=UNIT_MILLISECOND,
+    icon=ICON_TIMER,
+    accuracy_decimals=2,
+    state_class=STATE_CLASS_MEASUREMENT,
+    entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+)
+
+BUS_LOAD_SENSOR_SCHEMA = sensor.sensor_schema(
+    unit_of_measurement=UNIT_PERCENT,
+    icon="mdi:gauge",
+    accuracy_decimals=1,
+    state_class=STATE_CLASS_MEASUREMENT,
+    entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+)
+
+SEQ_TIME_SENSOR_SCHEMA = sensor.sensor_schema(
+    unit_of_measurement=UNIT_MILLISECOND,
+    icon=ICON_TIMER,
+    accuracy_decimals=0,
+    state_class=STATE_CLASS_MEASUREMENT,
+    entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+)
+
+COUNTER_SENSOR_SCHEMA = sensor.sensor_schema(
+    icon="mdi:counter",
+    accuracy_decimals=0,
+    state_class=STATE_CLASS_TOTAL_INCREASING,
+    entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+)
+
+RATE_SENSOR_SCHEMA = sensor.sensor_schema(
+    unit_of_measurement="1/s",
+    icon="mdi:speedometer",
+    accuracy_decimals=1,
+    state_class=STATE_CLASS_MEASUREMENT,
+    entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+)
+
+RX_TYPE_COUNTER_SCHEMA = COUNTER_SENSOR_SCHEMA.extend(
+    {cv.Required(CONF_MSG_TYPE): cv.hex_uint8_t}
+)
+
+# A field of a received payload, read in place and published on change.
+# Scale with the usual sensor filters (e.g. multiply: 0.1).
+TELEMETRY_SCHEMA = sensor.sensor_schema(
+    state_class=STATE_CLASS_MEASUREMENT,
+).extend(
+    {
+        cv.Required(CONF_MSG_TYPE): cv.hex_uint8_t,
+        cv.Optional(CONF_TRACKER): cv.hex_uint16_t,
+        cv.Required(CONF_OFFSET): cv.uint16_t,
+        cv.Optional(CONF_WIDTH, default=2): cv.one_of(1, 2, 4, int=True),
+        cv.Optional(CONF_BIG_ENDIAN, default=False): cv.boolean,
+        cv.Optional(CONF_SIGNED, default=False): cv.boolean,
+    }
+)
 
-CONFIG_SCHEMA = cv.Schema(
+TX_STEP_SCHEMA = cv.Schema(
     {
-        cv.GenerateID(): cv.declare_id(EfPsComponent),
-        cv.Required(CONF_CANBUS_ID): cv.use_id(canbus.CanbusComponent),
-        cv.Optional(CONF_UPDATE_INTERVAL, default="1s"): cv.update_interval,
+        cv.Required(CONF_ACTION): cv.one_of(*TX_ACTIONS, upper=True),
+        cv.Required(CONF_GAP): cv.All(
+            cv.positive_time_period_milliseconds,
+            cv.Range(max=cv.TimePeriod(milliseconds=65535)),
+        ),
     }
-).extend(cv.COMPONENT_SCHEMA)
+)
+
+
+def _tx_steps(config):
+    if CONF_TX_SCHEDULE not in config:
+        return DEFAULT_TX_SCHEDULE
+    return [
+        (s[CONF_ACTION], int(s[CONF_GAP].total_milliseconds))
+        for s in config[CONF_TX_SCHEDULE]
+    ]
+
+
+def _validate_tx_schedule(config):
+    total = sum(gap for _, gap in _tx_steps(config))
+    if not 0 < total <= 65535:
+        raise cv.Invalid(
+            f"{CONF_TX_SCHEDULE}: cycle must be 1..65535 ms, got {total} ms"
+        )
+    return config
+
+
+def _validate_enabled_messages(config):
+    built = config.get(CONF_TX_MESSAGES, TX_MESSAGES)
+    missing = [m for m in config.get(CONF_ENABLED_MESSAGES, []) if m not in built]
+    if missing:
+        raise cv.Invalid(
+            f"{CONF_ENABLED_MESSAGES}: {', '.join(missing)} not in {CONF_TX_MESSAGES}"
+        )
+    return config
+
+
+def _tx_schedule_header(messages, steps):
+    """ef_ps_schedule.h: the built-in message set and a kSeq without the steps
+    of messages left out. A dropped step's gap goes to the step before it, so
+    the remaining steps keep their timing."""
+    kept = []
+    carry = 0
+    for action, gap in steps:
+        if TX_ACTIONS[action] in messages:
+            kept.append([action, gap])
+        elif kept:
+            kept[-1][1] += gap
+        else:
+            carry += gap
+    if not kept:
+        kept.append(["IDLE", 0])
+    kept[-1][1] += carry  # leading gaps wrap to the end of the cycle
+
+    bits = " | ".join(f"TXM_{m}" for m in TX_MESSAGES if m in messages) or "0u"
+    lines = [
+        "#pragma once",
+        "// Generated by the ef_ps component from the YAML configuration; do not edit.",
+        "",
+        f"#define EF_TX_MESSAGES ({bits})",
+        "",
+        "static constexpr Step kSeq[] = {",
+        *(f"  {{A_{action}, {gap}}}," for action, gap in kept),
+        "};",
+        "",
+    ]
+    return "\n".join(lines)
+
+
+def _validate_tx_build(config):
+    """ef_ps_schedule.h and -DEF_PS_SCHEDULE_H apply to the whole build, so
+    every instance has to ask for the same TX set and schedule."""
+    def build(conf):
+        return _tx_schedule_header(conf.get(CONF_TX_MESSAGES, TX_MESSAGES), _tx_steps(conf))
+
+    want = build(config)
+    for other in fv.full_config.get().get("ef_ps", []):
+        if build(other) != want:
+            raise cv.Invalid(
+                f"{CONF_TX_MESSAGES}/{CONF_TX_SCHEDULE} are fixed for the whole build; "
+                f"'{config[CONF_ID]}' and '{other[CONF_ID]}' ask for different ones"
+            )
+    return config
+
+
+FINAL_VALIDATE_SCHEMA = _validate_tx_build
+
+
+def _reply_latency_key(req, pct):
+    return f"{req}_reply_latency_p{pct}"
+
+CONFIG_SCHEMA = cv.All(
+    cv.Schema(
+        {
+            cv.GenerateID(): cv.declare_id(EfPsComponent),
+            cv.Required(CONF_CANBUS_ID): cv.use_id(canbus.CanbusComponent),
+            cv.Optional(CONF_UPDATE_INTERVAL, default="1s"): cv.update_interval,
+            # Drive the kSeq schedule from a dedicated task instead of loop()
+            cv.Optional(CONF_TX_TASK, default=False): cv.boolean,
+            # Fix the TX message set / kSeq step table at build time, e.g.
+            # tx_messages: ["3C", "CB", "13"]; everything else is compiled out
+            cv.Optional(CONF_TX_MESSAGES): cv.ensure_list(
+                cv.one_of(*TX_MESSAGES, upper=True)
+            ),
+            cv.Optional(CONF_TX_SCHEDULE): cv.All(
+                cv.ensure_list(TX_STEP_SCHEMA), cv.Length(min=1, max=EF_SEQ_MAX_STEPS)
+            ),
+            # Initial config of this bridge (the global config for the first
+            # ef_ps); options left out keep their value. Voltages in 0.01 V.
+            cv.Optional(CONF_CAN_TX_ENABLED): cv.boolean,
+            cv.Optional(CONF_SERIAL): cv.All(cv.string_strict, cv.Length(max=16)),
+            cv.Optional(CONF_VOLTAGE): cv.int_range(min=0, max=65535),
+            cv.Optional(CONF_SOC): cv.int_range(min=0, max=100),
+            cv.Optional(CONF_TEMPERATURE): cv.int_range(min=-40, max=100),
+            cv.Optional(CONF_CHARGE_VOLTAGE): cv.int_range(min=0, max=65535),
+            # config.messageXX flags: the listed messages on, the others off
+            cv.Optional(CONF_ENABLED_MESSAGES): cv.ensure_list(
+                cv.one_of(*TX_MESSAGES, upper=True)
+            ),
+            cv.Optional(CONF_TX_LOGGING): cv.boolean,
+            cv.Optional(CONF_RX_LOGGING): cv.boolean,
+            # Bit rate used for bus-load figures; match the canbus bit_rate
+            cv.Optional(CONF_BUS_BIT_RATE, default=1000000): cv.one_of(
+                125000, 250000, 500000, 1000000, int=True
+            ),
+            # Utilisation over the last second / busiest 100 ms in it
+            cv.Optional(CONF_BUS_LOAD): BUS_LOAD_SENSOR_SCHEMA,
+            cv.Optional(CONF_BUS_LOAD_PEAK): BUS_LOAD_SENSOR_SCHEMA,
+            # kSeq timing: last full cycle, worst step lateness, stall re-anchors
+            cv.Optional(CONF_SEQ_CYCLE_MS): SEQ_TIME_SENSOR_SCHEMA,
+            cv.Optional(CONF_SEQ_LATE_MAX_MS): SEQ_TIME_SENSOR_SCHEMA,
+            cv.Optional(CONF_SEQ_RESYNCS): COUNTER_SENSOR_SCHEMA,
+            **{cv.Optional(name): COUNTER_SENSOR_SCHEMA for name in METRICS},
+            **{cv.Optional(f"{name}_rate"): RATE_SENSOR_SCHEMA for name in METRICS},
+            # Reassembled RX messages of one header msg_type, e.g. msg_type: 0xC4
+            cv.Optional(CONF_RX_TYPE_COUNTERS): cv.ensure_list(RX_TYPE_COUNTER_SCHEMA),
+            # Sensors fed straight from received payloads (PV input, grid output, ...)
+            cv.Optional(CONF_TELEMETRY): cv.ensure_list(TELEMETRY_SCHEMA),
+            # Run an automation on each received message of msg_type (and tracker);
+            # `payload` (decoded bytes) and `tracker` are available to lambdas
+            cv.Optional(CONF_ON_MESSAGE): automation.validate_automation(
+                {
+                    cv.GenerateID(CONF_TRIGGER_ID): cv.declare_id(EfPsMessageTrigger),
+                    cv.Required(CONF_MSG_TYPE): cv.hex_uint8_t,
+                    cv.Optional(CONF_TRACKER): cv.hex_uint16_t,
+                }
+            ),
+            **{
+                cv.Optional(_reply_latency_key(req, pct)): LATENCY_SENSOR_SCHEMA
+                for req in REPLY_LATENCY_TYPES
+                for pct in REPLY_LATENCY_PERCENTILES
+            },
+        }
+    ).extend(cv.COMPONENT_SCHEMA),
+    _validate_tx_schedule,
+    _validate_enabled_messages,
+)
 
 async def to_code(config):
     var = cg.new_Pvariable(config[CONF_ID])
@@ -30,3 +349,90 @@ async def to_code(config):
 
     cg.add(var.set_update_interval(config[CONF_UPDATE_INTERVAL]))
 
+    if config[CONF_TX_TASK]:
+        cg.add_build_flag("-DEF_PS_TX_TASK")
+
+    if CONF_TX_MESSAGES in config or CONF_TX_SCHEDULE in config:
+        header = _tx_schedule_header(
+            config.get(CONF_TX_MESSAGES, TX_MESSAGES), _tx_steps(config)
+        )
+        # src/ is on the include path; src/esphome/ is rewritten on every build
+        write_file_if_changed(CORE.relative_src_path("ef_ps_schedule.h"), header)
+        cg.add_build_flag("-DEF_PS_SCHEDULE_H")
+
+    for key, setter in (
+        (CONF_CAN_TX_ENABLED, var.set_can_tx_enabled),
+        (CONF_SERIAL, var.set_serial),
+        (CONF_VOLTAGE, var.set_voltage),
+        (CONF_SOC, var.set_soc),
+        (CONF_TEMPERATURE, var.set_temperature),
+        (CONF_CHARGE_VOLTAGE, var.set_charge_voltage),
+        (CONF_TX_LOGGING, var.set_tx_logging),
+        (CONF_RX_LOGGING, var.set_rx_logging),
+    ):
+        if key in config:
+            cg.add(setter(config[key]))
+    if CONF_ENABLED_MESSAGES in config:
+        # TXM_* bits, in TX_MESSAGES order
+        mask = sum(1 << i for i, m in enumerate(TX_MESSAGES) if m in config[CONF_ENABLED_MESSAGES])
+        cg.add(var.set_enabled_messages(mask))
+
+    cg.add(var.set_bus_bit_rate(config[CONF_BUS_BIT_RATE]))
+    if CONF_BUS_LOAD in config:
+        sens = await sensor.new_sensor(config[CONF_BUS_LOAD])
+        cg.add(var.set_bus_load_sensor(sens))
+    if CONF_BUS_LOAD_PEAK in config:
+        sens = await sensor.new_sensor(config[CONF_BUS_LOAD_PEAK])
+        cg.add(var.set_bus_load_peak_sensor(sens))
+    if CONF_SEQ_CYCLE_MS in config:
+        sens = await sensor.new_sensor(config[CONF_SEQ_CYCLE_MS])
+        cg.add(var.set_seq_cycle_sensor(sens))
+    if CONF_SEQ_LATE_MAX_MS in config:
+        sens = await sensor.new_sensor(config[CONF_SEQ_LATE_MAX_MS])
+        cg.add(var.set_seq_late_max_sensor(sens))
+    if CONF_SEQ_RESYNCS in config:
+        sens = await sensor.new_sensor(config[CONF_SEQ_RESYNCS])
+        cg.add(var.set_seq_resyncs_sensor(sens))
+
+    for i, name in enumerate(METRICS):
+        if name in config:
+            sens = await sensor.new_sensor(config[name])
+            cg.add(var.set_metric_sensor(i, sens))
+        if f"{name}_rate" in config:
+            sens = await sensor.new_sensor(config[f"{name}_rate"])
+            cg.add(var.set_metric_rate_sensor(i, sens))
+    for conf in config.get(CONF_RX_TYPE_COUNTERS, []):
+        sens = await sensor.new_sensor(conf)
+        cg.add(var.add_rx_type_sensor(conf[CONF_MSG_TYPE], sens))
+    for conf in config.get(CONF_TELEMETRY, []):
+        sens = await sensor.new_sensor(conf)
+        cg.add(
+            var.add_telemetry_sensor(
+                conf[CONF_MSG_TYPE],
+                conf.get(CONF_TRACKER, RX_TRACKER_ANY),
+                conf[CONF_OFFSET],
+                conf[CONF_WIDTH],
+                conf[CONF_BIG_ENDIAN],
+                conf[CONF_SIGNED],
+                sens,
+            )
+        )
+    for conf in config.get(CONF_ON_MESSAGE, []):
+        trigger = cg.new_Pvariable(conf[CONF_TRIGGER_ID])
+        cg.add(
+            var.add_on_message_trigger(
+                conf[CONF_MSG_TYPE], conf.get(CONF_TRACKER, RX_TRACKER_ANY), trigger
+            )
+        )
+        await automation.build_automation(
+            trigger,
+            [(cg.std_vector.template(cg.uint8), "payload"), (cg.uint16, "tracker")],
+            conf,
+        )
+
+    for i, req in enumerate(REPLY_LATENCY_TYPES):
+        for pct in REPLY_LATENCY_PERCENTILES:
+            key = _reply_latency_key(req, pct)
+            if key in config:
+                sens = await sensor.new_sensor(config[key])
+                cg.add(var.set_reply_latency_sensor(i, pct, sens))
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "ecoflow.h"
+#include "message_schema.h"
+#include "tx_schedule.h"
+#include "reassembler.h"
+#include "spsc_queue.h"
+#include "bus_load.h"
+#include "latency_histogram.h"
+#ifdef EF_PS_TX_TASK
+#include <mutex>
+#endif
+
+// Everything one PowerStream link needs: bindings to its config/BMS/watts
+// and CAN bus, XOR keys, prepared payloads, sequencer, reply queue and 14001
+// reassembly. Contexts are independent, so N of them drive N inverters on N
+// buses from one process. Allocate statically or once at setup; the struct is
+// large (reassembly slabs) and must not move after bridgeInit().
+//
+// The legacy free functions in ecoflow.h act on defaultBridge(), which is
+// bound to the global config, bms, inputWatt/outputWatt and sendCANFrame().
+
+// Frame sink for one bus (extended ID, len <= 8)
+typedef void (*BridgeSendFn)(void *arg, uint32_t id, const uint8_t *data, uint8_t len);
+
+// key/tracker are the request's: a reply is encoded with the key of the
+// request it answers, even when a newer request of the same kind came in
+struct PendingReply { uint8_t kind; uint8_t key; uint16_t tracker; uint32_t queuedMs; uint32_t requestUs; };
+
+// Overlays the prepare functions write into: only the dynamic fields of each
+// payload (msgXX::Overlay), the rest comes from the const templates in
+// ecoflow.cpp. Messages not built in take no space.
+struct BridgePayloads {
+#if EF_TX_HAS(13)
+  uint8_t p13[msg13::Overlay::size];
+#endif
+#if EF_TX_HAS(3C)
+  uint8_t p3C[msg3C::Overlay::size];
+#endif
+#if EF_TX_HAS(0B)
+  uint8_t p0B[msg0B::Overlay::size];
+#endif
+#if EF_TX_HAS(70)
+  uint8_t p70[msg70::Overlay::size];
+#endif
+#if EF_TX_HAS(5C)
+  uint8_t p5C[msg5C::Overlay::size];
+#endif
+#if EF_TX_HAS(68)
+  uint8_t p68[msg68::Overlay::size];
+#endif
+#if EF_TX_HAS(4F)
+  uint8_t p4F[msg4F::Overlay::size];
+#endif
+#if EF_TX_HAS(24)
+  uint8_t p24[msg24::Overlay::size];
+#endif
+};
+
+// config and watts as the TX side encodes them. The bound values belong to
+// the thread that writes them (loop()); with the TX task, TX code reads only
+// this copy, which that thread publishes under the TX lock.
+struct TxInputs {
+  EcoflowConfig config;
+  float         inputWatt;
+  float         outputWatt;
+};
+
+struct BridgeContext {
+  // ---- bindings ----
+  EcoflowConfig *config = nullptr;
+  BMS          *bms = nullptr;
+  const float  *inputWatt = nullptr;
+  const float  *outputWatt = nullptr;
+  BridgeSendFn  send = nullptr;
+  void         *sendArg = nullptr;
+  BridgeContext *next = nullptr;   // registered bridges (bridgeInit)
+  uint8_t       index = 0;         // registration order, tags this bridge's CAN log records
+  TxInputs      txIn = {};         // see bridgePublishInputs()
+
+  // ---- peer / XOR state ----
+  char    serialPS[17] = {0};      // PowerStream serial from C4, 16 chars + null
+  uint8_t xor3C = 0;               // C4 key, reused for the 3C reply
+  uint8_t xor8C = 0;               // DE 0x0105 key
+  uint8_t xor24 = 0;               // DE 0x0141 key
+  uint8_t xorCB = 0;               // CB 0x2031/0x2033 key
+  uint8_t xorCounter = 0;          // incrementing key for everything else
+  uint8_t txMsgType = 0;           // msg_type being encoded, for bus-load accounting
+
+  // ---- prepared payloads ----
+  BridgePayloads payload;
+  BmsSnapshot    bmsSnap = {};
+
+  // ---- sequencer ----
+  bool     seqRunning = false;
+  uint8_t  seqIndex = 0;
+  uint32_t nextDueMs = 0;          // absolute deadline of kSeq[seqIndex]
+  uint32_t lastC4ms = 0;
+  uint32_t cycleStartMs = 0;
+  bool     cycleStartValid = false;
+  bool     canHealth = false;      // heartbeat seen within C4_LOSS_TIMEOUT_MS
+  SeqStats seqStats = {};
+
+  // ---- replies ----
+  SpscQueue<PendingReply, 8> replyQueue;
+  TxReplyStats     replyStats[TX_REPLY_COUNT] = {};
+  LatencyHistogram rrLatency[RR_COUNT] = {};
+
+  // ---- RX ----
+  SpscQueue<ef_twai_message_t, EF_RX_QUEUE_LEN> rxQueue;
+  Reassembler14001 rx14001;
+  uint16_t rxBusType = BUS_LOAD_TYPE_OTHER;   // type of the last 14001 start
+  uint8_t  rxLastType = 0;
+  uint16_t rxLastTrackerBE = 0;
+
+  BusLoadMeter busLoad;
+  MetricsRegistry metrics;
+
+#ifdef EF_PS_TX_TASK
+  // With the dedicated TX task the sequencer and the RX-driven replies run
+  // on different threads. One recursive lock per bridge keeps a multi-frame
+  // message from being interleaved with another and guards sequencer state.
+  std::recursive_mutex txMutex;
+#endif
+};
+
+// Bind a context, add it to the registered list (setting ctx.index) and
+// seed the XOR counter.
+// Overlays are filled by the first prepare of each message.
+void bridgeInit(BridgeContext &ctx, EcoflowConfig *config, BMS *bms,
+                const float *inputWatt, const float *outputWatt,
+                BridgeSendFn send, void *sendArg);
+// Copy *config and the watts into ctx.txIn under the TX lock. Call from the
+// thread that writes them; canRxDrain() and bridgeInit() do. Without the TX
+// task the sequencer and sendCANMessage() also refresh the copy themselves.
+void bridgePublishInputs(BridgeContext &ctx);
+// First registered bridge (or nullptr); follow ->next for the rest
+BridgeContext *bridgeFirst();
+// canTxSequencerTick() on every registered bridge; returns the soonest deadline
+uint32_t bridgeTickAll();
+
+// ---- Per-bridge API; the ecoflow.h functions of the same name use defaultBridge() ----
+void sendCANMessage(BridgeContext &ctx, const uint8_t *header, const uint8_t *payload,
+                    size_t headerSize, size_t payloadSize);
+// Payload = const template `tmpl` with spans[i] replaced by the next
+// spans[i].len bytes of `overlay` (spans ascending, see schema::Overlay)
+void sendCANMessage(BridgeContext &ctx, const uint8_t *header, size_t headerSize,
+                    const uint8_t *tmpl, size_t payloadSize,
+                    const uint8_t *overlay, const schema::Span *spans, size_t spanCount);
+void processEcoFlowCAN(BridgeContext &ctx, const ef_twai_message_t &rx);
+// Bus-load costing of a received frame. canRxEnqueue() does it; callers that
+// feed processEcoFlowCAN() directly (SocketCAN) call it first.
+void canRxRecordLoad(BridgeContext &ctx, const ef_twai_message_t &rx);
+bool canRxEnqueue(BridgeContext &ctx, const ef_twai_message_t &rx);
+uint16_t canRxDrain(BridgeContext &ctx, uint16_t maxFrames);
+void canRxTick(BridgeContext &ctx);
+uint32_t canTxSequencerTick(BridgeContext &ctx);
+void canSequencer_onHeartbeatC4(BridgeContext &ctx);
+void txQueueReply(BridgeContext &ctx, TxReply kind, uint8_t key, uint16_t tracker, uint32_t requestUs);
+void txPumpReplies(BridgeContext &ctx);
+void canBusLoad(BridgeContext &ctx, BusLoadStats &out);
+const SeqStats &sequencerStats(BridgeContext &ctx);
+
+inline const char *getPeerSerial(const BridgeContext &ctx) { return ctx.serialPS; }
+inline const Reassembler14001Stats &rx14001Stats(const BridgeContext &ctx) { return ctx.rx14001.stats(); }
+inline const TxReplyStats &txReplyStats(const BridgeContext &ctx, TxReply kind) { return ctx.replyStats[kind]; }
+inline const LatencyHistogram &replyLatency(const BridgeContext &ctx, RequestType type) { return ctx.rrLatency[type]; }
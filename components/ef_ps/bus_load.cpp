@@ -0,0 +1,213 @@
+#include "bus_load.h"
+
+#ifdef EF_PS_TX_TASK
+#define BUS_LOAD_GUARD() std::lock_guard<std::mutex> busLoadGuard_(mutex_)
+#else
+#define BUS_LOAD_GUARD() do {} while (0)
+#endif
+
+// ================= Frame bit time =================
+//
+// CRC-15 and the stuff count of the stuffed part (SOF .. CRC) go a byte at a
+// time through tables generated at compile time; only the bits that do not
+// fill a byte before and after the CRC field go one by one.
+
+namespace {
+
+constexpr uint16_t kCrc15Poly = 0x4599;   // CRC-15/CAN, x^15+x^14+x^10+x^8+x^7+x^4+x^3+1
+
+constexpr uint16_t crc15Bit(uint16_t crc, uint8_t b) {
+  const uint8_t nxt = b ^ ((crc >> 14) & 1);
+  crc = (uint16_t)((crc << 1) & 0x7FFF);
+  return nxt ? (uint16_t)(crc ^ kCrc15Poly) : crc;
+}
+
+// Stuffing state: last bit and the length of its run (1..4) as
+// (last << 2) | (run - 1). A fifth equal bit adds the complementary stuff
+// bit, which starts the next run.
+constexpr uint8_t stuffBit(uint8_t st, uint8_t b, uint8_t &stuffed) {
+  if (b != (st >> 2)) return (uint8_t)(b << 2);
+  if ((st & 3) < 3) return (uint8_t)(st + 1);
+  stuffed++;
+  return (uint8_t)((b ^ 1) << 2);
+}
+
+struct Crc15Table {
+  uint16_t t[256];
+  constexpr Crc15Table() : t() {
+    for (int i = 0; i < 256; i++) {
+      uint16_t c = (uint16_t)(i << 7);
+      for (int b = 0; b < 8; b++) c = crc15Bit(c, 0);
+      t[i] = c;
+    }
+  }
+};
+
+// Per (state, byte): stuff bits added in the byte << 3 | state after it
+struct StuffTable {
+  uint8_t t[8][256];
+  constexpr StuffTable() : t() {
+    for (int st = 0; st < 8; st++) {
+      for (int v = 0; v < 256; v++) {
+        uint8_t s = (uint8_t)st, stuffed = 0;
+        for (int b = 7; b >= 0; b--) s = stuffBit(s, (uint8_t)((v >> b) & 1), stuffed);
+        t[st][v] = (uint8_t)((stuffed << 3) | s);
+      }
+    }
+  }
+};
+
+constexpr Crc15Table kCrc15{};
+constexpr StuffTable kStuff{};
+
+// Takes the frame after SOF field by field; each completed byte goes through
+// both tables at once, until the CRC field only through the stuff table
+struct FrameBitCounter {
+  uint32_t acc = 0;        // pending bits in the low accN
+  uint8_t  accN = 0;
+  uint16_t bits = 1;       // SOF
+  uint16_t crc = 0;        // a leading 0 (SOF) leaves CRC-15 at zero
+  uint8_t  st = 0;         // SOF: a run of one 0
+  uint8_t  stuffed = 0;
+  bool     inCrc = false;
+
+  // v holds exactly n <= 24 bits
+  void put(uint32_t v, uint8_t n) {
+    acc = (acc << n) | v;
+    accN = (uint8_t)(accN + n);
+    bits = (uint16_t)(bits + n);
+    while (accN >= 8) {
+      accN = (uint8_t)(accN - 8);
+      const uint8_t b = (uint8_t)(acc >> accN);
+      if (!inCrc) crc = (uint16_t)(((crc << 8) & 0x7FFF) ^ kCrc15.t[((crc >> 7) ^ b) & 0xFF]);
+      const uint8_t e = kStuff.t[st][b];
+      stuffed = (uint8_t)(stuffed + (e >> 3));
+      st = e & 7;
+    }
+  }
+
+  // CRC field from the bits so far; the partial byte left over is stuffed
+  // together with it
+  void putCrc() {
+    for (int8_t b = (int8_t)(accN - 1); b >= 0; b--) crc = crc15Bit(crc, (uint8_t)((acc >> b) & 1));
+    inCrc = true;
+    put(crc, 15);
+    for (int8_t b = (int8_t)(accN - 1); b >= 0; b--) st = stuffBit(st, (uint8_t)((acc >> b) & 1), stuffed);
+  }
+};
+
+}  // namespace
+
+uint16_t canFrameBits(uint32_t id, bool extended, const uint8_t *data, uint8_t dlc) {
+  if (dlc > 8) dlc = 8;
+  FrameBitCounter f;
+
+  if (extended) {
+    f.put((id >> 18) & 0x7FF, 11);         // base ID
+    f.put(0x3, 2);                         // SRR, IDE
+    f.put(id & 0x3FFFF, 18);               // ID extension
+    f.put(0, 3);                           // RTR, r1, r0
+  } else {
+    f.put(id & 0x7FF, 11);
+    f.put(0, 3);                           // RTR, IDE, r0
+  }
+  f.put(dlc, 4);
+  for (uint8_t i = 0; i < dlc; i++) f.put(data[i], 8);
+  f.putCrc();
+
+  // CRC delimiter, ACK slot, ACK delimiter, EOF(7), IFS(3): never stuffed
+  return (uint16_t)(f.bits + f.stuffed + 1 + 1 + 1 + 7 + 3);
+}
+
+// ================= Meter =================
+
+void BusLoadMeter::advance(uint32_t nowMs) {
+  const uint32_t target = nowMs / BUS_LOAD_BUCKET_MS;
+  if (!started_) { cur_ = target; started_ = true; return; }
+  if ((int32_t)(target - cur_) <= 0) return;
+
+  if (target - cur_ > kRing) {
+    // idle for longer than the ring: every bucket is empty now
+    const uint32_t peak = spanBits(cur_, BUS_LOAD_PEAK_SPAN);
+    if (peak > maxPeakBits_) maxPeakBits_ = peak;
+    for (uint16_t &b : bucket_) b = 0;
+    cur_ = target;
+    return;
+  }
+  while (cur_ != target) {
+    // close the open bucket and check the 100 ms span ending in it
+    const uint32_t peak = spanBits(cur_, BUS_LOAD_PEAK_SPAN);
+    if (peak > maxPeakBits_) maxPeakBits_ = peak;
+    cur_++;
+    bucket_[cur_ & (kRing - 1)] = 0;
+  }
+}
+
+uint32_t BusLoadMeter::spanBits(uint32_t lastBucket, uint16_t n) const {
+  uint32_t sum = 0;
+  for (uint16_t i = 0; i < n; i++) sum += bucket_[(lastBucket - i) & (kRing - 1)];
+  return sum;
+}
+
+float BusLoadMeter::pct(uint32_t bits, uint32_t ms) const {
+  return (float)bits * 100.0f * 1000.0f / ((float)bitrate_ * (float)ms);
+}
+
+void BusLoadMeter::record(BusLoadDir dir, uint16_t type, uint32_t id, bool extended,
+                          const uint8_t *data, uint8_t dlc, uint32_t nowMs) {
+  const uint16_t bits = canFrameBits(id, extended, data, dlc);
+  BUS_LOAD_GUARD();
+  advance(nowMs);
+
+  uint16_t &b = bucket_[cur_ & (kRing - 1)];
+  b = (b > 0xFFFF - bits) ? 0xFFFF : (uint16_t)(b + bits);
+  frames_[dir]++;
+  bits_[dir] += bits;
+
+  for (uint8_t i = 0; i < typeCount_; i++) {
+    if (type_[i].dir == dir && type_[i].type == type) {
+      type_[i].frames++;
+      type_[i].bits += bits;
+      return;
+    }
+  }
+  // table full: still counted in the totals above
+  if (typeCount_ == BUS_LOAD_TYPES) return;
+  BusLoadType &t = type_[typeCount_++];
+  t.dir = dir;
+  t.type = type;
+  t.frames = 1;
+  t.bits = bits;
+}
+
+void BusLoadMeter::snapshot(BusLoadStats &out, uint32_t nowMs) {
+  BUS_LOAD_GUARD();
+  advance(nowMs);
+
+  // closed buckets only; the open one is still filling
+  const uint32_t last = cur_ - 1;
+  uint32_t span = spanBits(last - BUS_LOAD_WINDOW + BUS_LOAD_PEAK_SPAN, BUS_LOAD_PEAK_SPAN);
+  uint32_t peak = span;
+  for (uint16_t i = BUS_LOAD_WINDOW - BUS_LOAD_PEAK_SPAN; i > 0; i--) {
+    const uint32_t end = last - i + 1;
+    span += bucket_[end & (kRing - 1)];
+    span -= bucket_[(end - BUS_LOAD_PEAK_SPAN) & (kRing - 1)];
+    if (span > peak) peak = span;
+  }
+
+  out.bitrate       = bitrate_;
+  out.loadPct       = pct(spanBits(last, BUS_LOAD_WINDOW), BUS_LOAD_WINDOW * BUS_LOAD_BUCKET_MS);
+  out.peak100Pct    = pct(peak, BUS_LOAD_PEAK_SPAN * BUS_LOAD_BUCKET_MS);
+  out.maxPeak100Pct = pct(maxPeakBits_, BUS_LOAD_PEAK_SPAN * BUS_LOAD_BUCKET_MS);
+  for (uint8_t d = 0; d < 2; d++) {
+    out.frames[d] = frames_[d];
+    out.bits[d]   = bits_[d];
+  }
+}
+
+size_t BusLoadMeter::types(BusLoadType *out, size_t cap) {
+  BUS_LOAD_GUARD();
+  size_t n = (typeCount_ < cap) ? typeCount_ : cap;
+  for (size_t i = 0; i < n; i++) out[i] = type_[i];
+  return n;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#ifdef EF_PS_TX_TASK
+#include <mutex>
+#endif
+
+// CAN bus-load meter.
+//
+// Every TX and RX frame is costed at its exact on-wire length: SOF through
+// the CRC sequence with stuff bits counted from the real ID/DLC/data/CRC-15
+// bit stream, plus CRC delimiter, ACK, EOF and the 3-bit inter-frame space.
+// Bits land in 10 ms buckets; the last second gives the sliding utilisation
+// and the busiest run of 10 buckets the peak 100 ms load. Cumulative bits
+// are also kept per (direction, message type) to show each type's share.
+
+#ifndef EF_CAN_BITRATE
+#define EF_CAN_BITRATE 1000000UL   // bit/s, 500000 on boards without 1M
+#endif
+
+#define BUS_LOAD_BUCKET_MS   10
+#define BUS_LOAD_WINDOW      100   // buckets in the utilisation window (1 s)
+#define BUS_LOAD_PEAK_SPAN   10    // buckets in the peak window (100 ms)
+#ifndef BUS_LOAD_TYPES
+#define BUS_LOAD_TYPES       24    // distinct (dir, type) pairs tracked
+#endif
+
+enum BusLoadDir : uint8_t { BUS_RX = 0, BUS_TX = 1 };
+
+// Frames that are not part of a typed 0x10x14001 / 0x10x03001 message
+#define BUS_LOAD_TYPE_OTHER 0x100
+
+struct BusLoadType {
+  uint8_t  dir;       // BusLoadDir
+  uint16_t type;      // header msg_type or BUS_LOAD_TYPE_OTHER
+  uint32_t frames;
+  uint64_t bits;
+};
+
+struct BusLoadStats {
+  uint32_t bitrate;
+  float    loadPct;         // last second
+  float    peak100Pct;      // busiest 100 ms within the last second
+  float    maxPeak100Pct;   // busiest 100 ms since boot
+  uint32_t frames[2];       // per BusLoadDir, since boot
+  uint64_t bits[2];
+};
+
+// Exact bit time of a data frame (11- or 29-bit ID), including stuffing and IFS
+uint16_t canFrameBits(uint32_t id, bool extended, const uint8_t *data, uint8_t dlc);
+
+class BusLoadMeter {
+ public:
+  void setBitrate(uint32_t bps) { bitrate_ = bps ? bps : EF_CAN_BITRATE; }
+  uint32_t bitrate() const { return bitrate_; }
+
+  // Safe from the loop and the TX task
+  void record(BusLoadDir dir, uint16_t type, uint32_t id, bool extended,
+              const uint8_t *data, uint8_t dlc, uint32_t nowMs);
+
+  void snapshot(BusLoadStats &out, uint32_t nowMs);
+  // Copy up to `cap` per-type entries, in first-seen order. Returns the count.
+  size_t types(BusLoadType *out, size_t cap);
+
+ private:
+  static const uint16_t kRing = 128;   // > BUS_LOAD_WINDOW + 1, power of two
+
+  void advance(uint32_t nowMs);
+  uint32_t spanBits(uint32_t lastBucket, uint16_t n) const;
+  float pct(uint32_t bits, uint32_t ms) const;
+
+  uint32_t bitrate_ = EF_CAN_BITRATE;
+  uint16_t bucket_[kRing] = {};        // 10 ms at 1 Mbit/s is at most 10000 bits
+  uint32_t cur_ = 0;                   // absolute index of the open bucket
+  bool     started_ = false;
+  uint32_t maxPeakBits_ = 0;
+  uint32_t frames_[2] = {};
+  uint64_t bits_[2] = {};
+  BusLoadType type_[BUS_LOAD_TYPES] = {};
+  uint8_t  typeCount_ = 0;
+#ifdef EF_PS_TX_TASK
+  std::mutex mutex_;                   // TX task records while loop() reads, per meter
+#endif
+};
@@ -0,0 +1,70 @@
+#include "can_log.h"
+#include <string.h>
+#include <cstdio>
+
+CanLogRing canLog;
+
+static const uint32_t kMask = EF_CAN_LOG_CAPACITY - 1;
+
+void CanLogRing::push(CanLogDir dir, uint8_t bridge, uint32_t ts_ms, uint32_t id, const uint8_t *data, uint8_t dlc) {
+  const uint32_t ticket = head_.fetch_add(1, std::memory_order_relaxed);
+  Slot &s = slots_[ticket & kMask];
+
+  s.seq.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  if (dlc > 8) dlc = 8;
+  s.rec.ts_ms  = ts_ms;
+  s.rec.id     = id;
+  s.rec.dlc    = dlc;
+  s.rec.dir    = dir;
+  s.rec.bridge = bridge;
+  memcpy(s.rec.data, data, dlc);
+
+  s.seq.store(ticket + 1, std::memory_order_release);
+}
+
+CanLogCursor CanLogRing::oldest() const {
+  CanLogCursor c;
+  const uint32_t head = written();
+  c.next = (head > EF_CAN_LOG_CAPACITY) ? head - EF_CAN_LOG_CAPACITY : 0;
+  return c;
+}
+
+bool CanLogRing::read(CanLogCursor &cur, CanLogRecord &out) const {
+  for (;;) {
+    const uint32_t head = written();
+    if (cur.next == head) return false;
+
+    // Fell behind the writer: skip what was overwritten
+    if (head - cur.next > EF_CAN_LOG_CAPACITY) {
+      cur.lost += head - EF_CAN_LOG_CAPACITY - cur.next;
+      cur.next = head - EF_CAN_LOG_CAPACITY;
+    }
+
+    const Slot &s = slots_[cur.next & kMask];
+    const uint32_t seq = s.seq.load(std::memory_order_acquire);
+    if (seq == 0 || seq - 1 < cur.next) return false;   // still being written
+
+    out = s.rec;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (s.seq.load(std::memory_order_relaxed) == cur.next + 1) {
+      cur.next++;
+      return true;
+    }
+    // Overwritten while copying; retry from the new position
+    cur.lost++;
+    cur.next++;
+  }
+}
+
+size_t CanLogRing::formatText(const CanLogRecord &r, char *out, size_t cap) {
+  char bridge[4] = "";
+  if (r.bridge) snprintf(bridge, sizeof(bridge), "%u", (unsigned)r.bridge);
+  int n = snprintf(out, cap, "(%05lu.%03lu000) %s%s %08lX#",
+                   (unsigned long)(r.ts_ms / 1000), (unsigned long)(r.ts_ms % 1000),
+                   r.dir == CAN_LOG_TX ? "TX" : "vcanRx", bridge, (unsigned long)r.id);
+  for (uint8_t i = 0; i < r.dlc && n > 0 && (size_t)n < cap; i++)
+    n += snprintf(out + n, cap - n, "%02X", r.data[i]);
+  return (n > 0) ? ((size_t)n < cap ? (size_t)n : cap - 1) : 0;
+}
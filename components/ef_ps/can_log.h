@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+// Fixed-capacity binary CAN frame log.
+//
+// Writers (TX encoder, RX path) only copy a small record into the next slot;
+// nothing is allocated and old records are overwritten once the ring wraps.
+// Readers keep their own cursor and format records to text on demand.
+// One ring serves every bridge; each record carries its bridge's index.
+
+#ifndef EF_CAN_LOG_CAPACITY
+#define EF_CAN_LOG_CAPACITY 128   // records, must be a power of two
+#endif
+
+enum CanLogDir : uint8_t { CAN_LOG_RX = 0, CAN_LOG_TX = 1 };
+
+struct CanLogRecord {
+  uint32_t ts_ms;
+  uint32_t id;
+  uint8_t  dlc;
+  uint8_t  dir;      // CanLogDir
+  uint8_t  bridge;   // BridgeContext::index
+  uint8_t  data[8];
+};
+
+// Reader position. `lost` counts records overwritten before they were read.
+struct CanLogCursor {
+  uint32_t next = 0;
+  uint32_t lost = 0;
+};
+
+class CanLogRing {
+ public:
+  static_assert((EF_CAN_LOG_CAPACITY & (EF_CAN_LOG_CAPACITY - 1)) == 0,
+                "EF_CAN_LOG_CAPACITY must be a power of two");
+
+  // Lock-free; safe from several writers (loop, TX task, RX callback)
+  void push(CanLogDir dir, uint8_t bridge, uint32_t ts_ms, uint32_t id, const uint8_t *data, uint8_t dlc);
+
+  // Copy the next record at `cur` into `out`. Returns false when caught up.
+  bool read(CanLogCursor &cur, CanLogRecord &out) const;
+
+  // Cursor positioned at the oldest record still held
+  CanLogCursor oldest() const;
+  uint32_t written() const { return head_.load(std::memory_order_acquire); }
+
+  // Lazy formatting, only called by consumers. RX lines keep the
+  // candump-style "vcanRx" prefix of the original string log; records of
+  // bridges other than the first get the bridge index appended:
+  //   "(00123.456000) TX 10003001#AA0384003C"
+  //   "(00123.457000) vcanRx 10014001#AA034500C4"
+  //   "(00123.458000) vcanRx1 10014001#AA034500C4"
+  static size_t formatText(const CanLogRecord &r, char *out, size_t cap);
+
+ private:
+  struct Slot {
+    std::atomic<uint32_t> seq{0};   // ticket + 1 once published, 0 while being written
+    CanLogRecord rec;
+  };
+
+  std::atomic<uint32_t> head_{0};
+  Slot slots_[EF_CAN_LOG_CAPACITY];
+};
+
+extern CanLogRing canLog;
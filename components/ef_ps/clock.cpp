@@ -0,0 +1,39 @@
+#include "clock.h"
+
+#if defined(ESP32) || defined(ESP8266)
+#include <esp_timer.h>
+#else
+#include <chrono>
+#endif
+
+static ClockNowFn g_clockFn = nullptr;
+static void *g_clockArg = nullptr;
+
+uint64_t clockPlatformUs() {
+#if defined(ESP32) || defined(ESP8266)
+  return (uint64_t)esp_timer_get_time();
+#else
+  return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+void clockSet(ClockNowFn fn, void *arg) {
+  g_clockArg = arg;
+  g_clockFn = fn;
+}
+
+uint64_t clockNowUs() {
+  return g_clockFn ? g_clockFn(g_clockArg) : clockPlatformUs();
+}
+
+void VirtualClock::install(uint64_t startUs) {
+  nowUs = simStartUs = startUs;
+  wallStartUs = clockPlatformUs();
+  clockSet(read, this);
+}
+
+double VirtualClock::ratio() const {
+  const uint64_t wall = clockPlatformUs() - wallStartUs;
+  return wall ? (double)(nowUs - simStartUs) / (double)wall : 0.0;
+}
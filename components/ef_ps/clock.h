@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stdint.h>
+
+// One time source for the protocol core. Sequencer deadlines, the C4 loss
+// timeout, 14001 reassembly timeouts, reply latency, bus load and the CAN log
+// all read clockNowUs(). By default that is the platform monotonic clock
+// (esp_timer on ESP, steady_clock on a host). A host harness can install
+// another source with clockSet(), e.g. a VirtualClock that it advances
+// from one deadline to the next.
+
+typedef uint64_t (*ClockNowFn)(void *arg);
+
+// Install a time source; nullptr restores the platform clock. Not
+// synchronised: switch before any bridge runs.
+void clockSet(ClockNowFn fn, void *arg);
+
+uint64_t clockNowUs();
+uint64_t clockPlatformUs();   // real monotonic time, whatever is installed
+
+inline uint32_t clockMillis() { return (uint32_t)(clockNowUs() / 1000u); }
+inline uint32_t clockMicros() { return (uint32_t)clockNowUs(); }
+
+#define EF_MILLIS() clockMillis()
+#define EF_MICROS() clockMicros()
+
+// Time that only moves when told to. Runs are deterministic for a given
+// input sequence, and ratio() tells how much faster than real time they went.
+struct VirtualClock {
+  uint64_t nowUs = 0;
+  uint64_t simStartUs = 0;
+  uint64_t wallStartUs = 0;
+
+  // Start at `startUs` and become the clock source
+  void install(uint64_t startUs = 0);
+  void uninstall() { clockSet(nullptr, nullptr); }
+
+  void advance(uint64_t us) { nowUs += us; }
+  void advanceTo(uint64_t us) { if (us > nowUs) nowUs = us; }
+
+  // Simulated time elapsed per wall time elapsed since install()
+  double ratio() const;
+
+  static uint64_t read(void *arg) { return static_cast<VirtualClock *>(arg)->nowUs; }
+};
@@ -0,0 +1,79 @@
+#include "crc16.h"
+
+namespace {
+
+constexpr uint16_t kPoly = 0xA001;
+
+// Tables are generated at compile time and land in rodata (flash on ESP)
+template <int N>
+struct SliceTables {
+  uint16_t t[N][256];
+  constexpr SliceTables() : t() {
+    for (int i = 0; i < 256; i++) {
+      uint16_t c = (uint16_t)i;
+      for (int b = 0; b < 8; b++) c = (c & 1) ? (uint16_t)((c >> 1) ^ kPoly) : (uint16_t)(c >> 1);
+      t[0][i] = c;
+    }
+    for (int k = 1; k < N; k++)
+      for (int i = 0; i < 256; i++)
+        t[k][i] = (uint16_t)((t[k - 1][i] >> 8) ^ t[0][t[k - 1][i] & 0xFF]);
+  }
+};
+
+struct NibbleTable {
+  uint16_t t[16];
+  constexpr NibbleTable() : t() {
+    for (int i = 0; i < 16; i++) {
+      uint16_t c = (uint16_t)i;
+      for (int b = 0; b < 4; b++) c = (c & 1) ? (uint16_t)((c >> 1) ^ kPoly) : (uint16_t)(c >> 1);
+      t[i] = c;
+    }
+  }
+};
+
+#if EF_CRC16_IMPL == EF_CRC16_NIBBLE
+
+constexpr NibbleTable kNib{};
+
+inline uint16_t step(uint16_t crc, uint8_t b) {
+  crc ^= b;
+  crc = (uint16_t)((crc >> 4) ^ kNib.t[crc & 0x0F]);
+  crc = (uint16_t)((crc >> 4) ^ kNib.t[crc & 0x0F]);
+  return crc;
+}
+
+#else
+
+constexpr int kSlices = (EF_CRC16_IMPL == EF_CRC16_SLICE8) ? 8 :
+                        (EF_CRC16_IMPL == EF_CRC16_SLICE4) ? 4 : 1;
+constexpr SliceTables<kSlices> kTab{};
+
+inline uint16_t step(uint16_t crc, uint8_t b) {
+  return (uint16_t)(kTab.t[0][(crc ^ b) & 0xFF] ^ (crc >> 8));
+}
+
+#endif
+
+}  // namespace
+
+uint16_t crc16Update(uint16_t crc, const uint8_t *data, size_t len) {
+#if EF_CRC16_IMPL == EF_CRC16_SLICE8
+  const uint16_t (*t)[256] = kTab.t;
+  while (len >= 8) {
+    crc = (uint16_t)(t[7][(data[0] ^ crc) & 0xFF] ^ t[6][data[1] ^ (crc >> 8)] ^
+                     t[5][data[2]] ^ t[4][data[3]] ^
+                     t[3][data[4]] ^ t[2][data[5]] ^
+                     t[1][data[6]] ^ t[0][data[7]]);
+    data += 8; len -= 8;
+  }
+#elif EF_CRC16_IMPL == EF_CRC16_SLICE4
+  const uint16_t (*t)[256] = kTab.t;
+  while (len >= 4) {
+    crc = (uint16_t)(t[3][(data[0] ^ crc) & 0xFF] ^ t[2][data[1] ^ (crc >> 8)] ^
+                     t[1][data[2]] ^ t[0][data[3]]);
+    data += 4; len -= 4;
+  }
+#endif
+  while (len--) crc = step(crc, *data++);
+  return crc;
+}
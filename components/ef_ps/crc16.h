@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// CRC16 used by EcoFlow framing (reflected poly 0xA001, init 0, no final XOR).
+//
+// Incremental use:
+//   uint16_t c = crc16Init();
+//   c = crc16Update(c, a, alen);
+//   c = crc16Update(c, b, blen);
+//   uint16_t crc = crc16Final(c);
+//
+// The engine is picked at compile time with EF_CRC16_IMPL:
+//   EF_CRC16_NIBBLE  16-entry table (32 B), two lookups per byte
+//   EF_CRC16_BYTE    256-entry table (512 B), one lookup per byte
+//   EF_CRC16_SLICE4  4x256 tables (2 KB), four bytes per step
+//   EF_CRC16_SLICE8  8x256 tables (4 KB), eight bytes per step
+// Default: nibble on ESP32-C3, byte on other ESP targets, slice-by-8 on host.
+#define EF_CRC16_NIBBLE 1
+#define EF_CRC16_BYTE   2
+#define EF_CRC16_SLICE4 4
+#define EF_CRC16_SLICE8 8
+
+#ifndef EF_CRC16_IMPL
+#if defined(CONFIG_IDF_TARGET_ESP32C3)
+#define EF_CRC16_IMPL EF_CRC16_NIBBLE
+#elif defined(ESP32) || defined(ESP8266)
+#define EF_CRC16_IMPL EF_CRC16_BYTE
+#else
+#define EF_CRC16_IMPL EF_CRC16_SLICE8
+#endif
+#endif
+
+inline uint16_t crc16Init() { return 0; }
+uint16_t crc16Update(uint16_t crc, const uint8_t *data, size_t len);
+inline uint16_t crc16Final(uint16_t crc) { return crc; }
+
+// One-shot helper
+inline uint16_t crc16(const uint8_t *data, size_t len) {
+  return crc16Final(crc16Update(crc16Init(), data, len));
+}
@@ -1,213 +1,189 @@
 #include "ecoflow.h"
+#include "bridge_context.h"
 #include "can.h"   // must provide sendCANFrame()
+#include "frame_encoder.h"
+#include "can_log.h"
+#include "reassembler.h"
+#include "message_schema.h"
+#include "rx_dispatch.h"
+#include "clock.h"   // EF_MILLIS() / EF_MICROS()
 #include <string.h>
 #include <cstdlib>
 #include <cstdio>
-#include <chrono>
-#if defined(ESP32) || defined(ESP8266)
-#include <esp_timer.h>
-#define EF_MILLIS() ((unsigned long)(esp_timer_get_time() / 1000ULL))
-#else
-#define EF_MILLIS() ((unsigned long)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count())
-#endif
-#include <cstdio>
-
-//EcoFlow PowerStream serial (from C4), 16 chars + null
-static char SerialPS[17] = {0};
 
 const char* getPeerSerial() {
-  return SerialPS;
+  return defaultBridge().serialPS;
 }
 
-volatile uint32_t can_rx_count = 0;
-volatile uint32_t can_rx_dropped = 0;
-volatile uint32_t can_decoded = 0;
-
 float inputWatt = 0.0f;
 float outputWatt = 0.0f;
-std::string canLog = "";
-
-// ================= XOR state =================
-uint8_t xor3C; // Save C4 XOR
-uint8_t xor8C; // Save 8C XOR
-uint8_t xor24; // Save 8C XOR
-uint8_t xorCB; // Save CB but only for 2031 & 2033 BMS Limits
-uint8_t xorCounter; //Incrementing counter for XOR byte
 
 // ================= Sequencer health input =================
 #ifndef C4_LOSS_TIMEOUT_MS
 #define C4_LOSS_TIMEOUT_MS 800
 #endif
 
-// Action Sequencer definitions
-enum TxAction : uint8_t {
-  A_70,
-  A_0B_04, A_0B_02, A_0B_05, A_0B_50, A_0B_08,
-  A_4F,
-  A_68,
-  A_13,
-  A_CB_321, A_CB_141,
-  A_5C,
-  A_CB_150,
-};
+// kSeq and TxAction live in tx_schedule.h (default or generated from YAML)
+static constexpr uint8_t kSeqCount = sizeof(kSeq)/sizeof(kSeq[0]);
 
-// One cycle step: each action and the gap in ms
-struct Step { TxAction act; uint16_t gap_ms; };
-
-static const Step kSeq[] = {
-  {A_70,     25},
-  {A_0B_04,   1},
-  {A_0B_02,   1},
-  {A_0B_05,   1},
-  {A_0B_50,   1},
-  {A_0B_08, 100},
-  {A_4F,    100},
-  {A_0B_04,   1},
-  {A_0B_02,   1},
-  {A_0B_05,   1},
-  {A_0B_50,   1},
-  {A_0B_08, 100},
-  {A_68,     4},
-  {A_13,     1},
-  {A_CB_321, 1},
-  {A_CB_141, 1},
-  {A_5C,     1},
-  {A_CB_150,100},
-  {A_0B_04,  1},
-  {A_0B_02,  1},
-  {A_0B_05,  1},
-  {A_0B_50,  1},
-  {A_0B_08,200},
-};
-static const uint8_t kSeqCount = sizeof(kSeq)/sizeof(kSeq[0]);
+static_assert(sizeof(kSeq)/sizeof(kSeq[0]) <= EF_SEQ_MAX_STEPS, "kSeq longer than EF_SEQ_MAX_STEPS");
+
+// The TX lock lives in each BridgeContext (see bridge_context.h)
+#ifdef EF_PS_TX_TASK
+#define EF_TX_GUARD(ctx) std::lock_guard<std::recursive_mutex> txGuard_((ctx).txMutex)
+#else
+#define EF_TX_GUARD(ctx) do {} while (0)
+#endif
 
-// Runtime state
-static bool     g_seqRunning = false;
-static uint8_t  g_seqIndex   = 0;
-static uint32_t g_nextDueMs  = 0;
-static uint32_t g_lastC4ms   = 0;
+// 32-bit millisecond clock; compare with timeReached() so the ~49 day wrap is harmless
+static inline uint32_t nowMs() { return (uint32_t)EF_MILLIS(); }
+static inline bool timeReached(uint32_t now, uint32_t due) { return (int32_t)(now - due) >= 0; }
 
 // Forward
-static void sendAction(TxAction a);
+static void sendAction(BridgeContext &ctx, TxAction a);
 
 // ================= Headers =================
-uint8_t header_3C[] = {
+// Templates are const, so they stay in flash (.rodata); the dynamic fields
+// of each bridge live in its overlays (BridgePayloads) and are merged in
+// while encoding.
+#if EF_TX_HAS(3C)
+static const uint8_t header_3C[] = {
     0xaa, 0x03, 0x84, 0x00, 0x3c, 0x2e, 0xac, 0x04,
     0x00, 0x00, 0x0b, 0x3c, 0x03, 0x14, 0x01, 0x01,
     0x03, 0x2f
 };
+#endif
 
-uint8_t header_13[] = {
+#if EF_TX_HAS(13)
+static const uint8_t header_13[] = {
     0xAA ,0x03, 0xBA, 0x00, 0x13, 0x2C, 0x00, 0x1a,
     0x00, 0x00, 0x0B, 0x3C, 0x03, 0x14, 0x01, 0x00,
     0x03, 0x1A
 };
+#endif
 
 
-uint8_t header_CB_2031[] = { // BMS Upper Ack
+#if EF_TX_HAS(CB)
+static const uint8_t header_CB_2031[] = { // BMS Upper Ack
     0xAA, 0x03, 0x01, 0x00, 0xCB, 0x2E, 0xF7, 0x3A, 
     0x00, 0x00, 0x0B, 0x3C, 0x03, 0x14, 0x01, 0x01, 
     0x20, 0x31
 };
 
-uint8_t header_CB_2033[] = { // BMS Lower Ack
+static const uint8_t header_CB_2033[] = { // BMS Lower Ack
     0xAA, 0x03, 0x01, 0x00, 0xCB, 0x2E, 0xF7, 0x3A, 
     0x00, 0x00, 0x0B, 0x3C, 0x03, 0x14, 0x01, 0x01, 
     0x20, 0x33
 };
 
-uint8_t header_CB_321[] = { // BMS Lower Ack
+static const uint8_t header_CB_321[] = { // BMS Lower Ack
     0xAA, 0x03, 0x01, 0x00, 0xCB, 0x2C, 0x5E, 0x47, 
     0x01, 0x00, 0x0B, 0x3C, 0x03, 0x08, 0x01, 0x00, 
     0x03, 0x21
 };
 
-uint8_t header_CB_141[] = { 
+static const uint8_t header_CB_141[] = { 
     0xAA, 0x03, 0x01, 0x00, 0xCB, 0x2C, 0x5F, 0x47, 
     0x01, 0x00, 0x0B, 0x3C, 0x03, 0x08, 0x01, 0x00, 
     0x01, 0x41
 };
 
-uint8_t header_CB_150[] = { 
+static const uint8_t header_CB_150[] = { 
     0xAA, 0x03, 0x01, 0x00, 0xCB, 0x2C, 0x72, 0x47, 
     0x01, 0x00, 0x0B, 0x3C, 0x03, 0x08, 0x01, 0x00, 
     0x01, 0x50
 };
+#endif
 
-uint8_t header_70[] = {
+#if EF_TX_HAS(70)
+static const uint8_t header_70[] = {
     0xAA, 0x03, 0x20, 0x00, 0x70, 0x2C, 0x86, 0x44, 
     0x01, 0x00, 0x0B, 0x3C, 0x03, 0x35, 0x01, 0x00, 
     0x35, 0x10
 };
+#endif
 
-uint8_t header_0B_02[] = {
+#if EF_TX_HAS(0B)
+static const uint8_t header_0B_02[] = {
     0xAA, 0x03, 0x1A, 0x00, 0x0B, 0x2C, 0x8E, 0x47, 
     0x01, 0x00, 0x0B, 0x3C, 0x03, 0x02, 0x01, 0x00, 
     0x03, 0x07
 };
 
-uint8_t header_0B_04[] = {
+static const uint8_t header_0B_04[] = {
     0xAA, 0x03, 0x1A, 0x00, 0x0B, 0x2C, 0x8E, 0x47, 
     0x01, 0x00, 0x0B, 0x3C, 0x03, 0x04, 0x01, 0x00, 
     0x03, 0x07
 };
 
-uint8_t header_0B_05[] = {
+static const uint8_t header_0B_05[] = {
     0xAA, 0x03, 0x1A, 0x00, 0x0B, 0x2C, 0x8C, 0x47, 
     0x01, 0x00, 0x0B, 0x3C, 0x03, 0x05, 0x01, 0x00, 
     0x03, 0x07
 };
 
-uint8_t header_0B_08[] = {
+static const uint8_t header_0B_08[] = {
     0xAA, 0x03, 0x1A, 0x00, 0x0B, 0x2C, 0x8E, 0x47, 
     0x01, 0x00, 0x0B, 0x3C, 0x03, 0x08, 0x01, 0x00, 
     0x03, 0x07
 };
 
-uint8_t header_0B_50[] = {
+static const uint8_t header_0B_50[] = {
     0xAA, 0x03, 0x1A, 0x00, 0x0B, 0x2C, 0x8D, 0x47, 
     0x01, 0x00, 0x0B, 0x3C, 0x03, 0x50, 0x01, 0x00, 
     0x03, 0x07
 };
+#endif
 
-uint8_t header_5C[] = {
+#if EF_TX_HAS(5C)
+static const uint8_t header_5C[] = {
     0xAA, 0x03, 0x0A, 0x00, 0x5C, 0x2C, 0x98, 0x46, 
     0x01, 0x00, 0x0B, 0x3C, 0x03, 0x08, 0x01, 0x00, 
     0x03, 0x22
 };
+#endif
 
-uint8_t header_68[] = {
+#if EF_TX_HAS(68)
+static const uint8_t header_68[] = {
     0xAA, 0x03, 0x80, 0x00, 0x68, 0x2C, 0xB9, 0x45, 
     0x01, 0x00, 0x0B, 0x3C, 0x03, 0x21, 0x01, 0x00, 
     0x03, 0x01
 };
+#endif
 
-uint8_t header_C4[] = {
+static const uint8_t header_C4[] = {
     0xAA, 0x03, 0x45, 0x00, 0xC4, 0x2D, 0x29, 0x3B, 
     0x00, 0x00, 0x01, 0x4B, 0x14, 0x03, 0x01, 0x01, 
     0x03, 0x02
 };
 
-uint8_t header_4F[] = {
+#if EF_TX_HAS(4F)
+static const uint8_t header_4F[] = {
    0xAA, 0x03, 0x23, 0x00, 0x4F, 0x2C, 0x8A, 0x05, 
    0x00, 0x00, 0x0B, 0x3C, 0x03, 0x21, 0x01, 0x00, 
    0x03, 0x01
 };
+#endif
 
-uint8_t header_8C[] = {
+#if EF_TX_HAS(8C)
+static const uint8_t header_8C[] = {
   0xAA, 0x03, 0x2C, 0x00, 0x8C, 0x2F, 0xBF, 0x00, 
   0x00, 0x00, 0x0B, 0x3C, 0x03, 0x14, 0x01, 0x01, 
   0x01, 0x05
 };
+#endif
 
-uint8_t header_24[] = {
+#if EF_TX_HAS(24)
+static const uint8_t header_24[] = {
   0xAA, 0x03, 0x24, 0x00, 0x24, 0x2F, 0xCD, 0x3A,
   0x00, 0x00, 0x0B, 0x3C, 0x03, 0x14, 0x01, 0x01,
   0x01, 0x41
 };
+#endif
 
 // ================= Payloads =================
-uint8_t payload_13[] = {
+#if EF_TX_HAS(13)
+static const uint8_t payload_13[] = {
 // Start of Payload 0 - 2
 0x01, 0x01, 0x01, 
 
@@ -323,8 +299,10 @@ uint8_t payload_13[] = {
 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
 0x00, 0x00, 0x00, 0x00
 };
+#endif
 
-uint8_t payload_3C[] = {
+#if EF_TX_HAS(3C)
+static const uint8_t payload_3C[] = {
     0x01, 
 
     0x84, 0x00,
@@ -350,6 +328,7 @@ uint8_t payload_3C[] = {
     0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
     0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
     0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
     0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
     
     0x15, 0x15, 
@@ -364,31 +343,41 @@ uint8_t payload_3C[] = {
     
     0x00, 0x64
   };
+#endif
 
-uint8_t payload_CB[] = {
+#if EF_TX_HAS(CB)
+static const uint8_t payload_CB[] = {
     0x00
   };
+#endif
 
-uint8_t payload_70[] = {
+#if EF_TX_HAS(70)
+static const uint8_t payload_70[] = {
     0x01, 0x4D, 0x31, 0x30, 0x32, 0x5A, 0x33, 0x42, 
     0x34, 0x5A, 0x45, 0x35, 0x48, 0x30, 0x36, 0x30, 
     0x31, 0x01, 0x0B, 0x3C, 0x01, 0x01, 0x03, 0x4D, 
     0x01, 0x00, 0x01, 0x11, 0x00, 0x00, 0x00, 0x00
   };
+#endif
 
-uint8_t payload_0B[] = {
+#if EF_TX_HAS(0B)
+static const uint8_t payload_0B[] = {
     0x02, 0xF0, 0xD2, 0x00, 0x00, 0x00, 0x00, 0x00, 
     0x00, 0x01, 0xCf, 0x00, 0x00, 0x00, 0x01, 0x00, 
     0x03, 0x01, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 
     0x00, 0x00
   };
+#endif
 
-uint8_t payload_5C[] = {
+#if EF_TX_HAS(5C)
+static const uint8_t payload_5C[] = {
     0x00, 0x02, 0x07, 0xD3, 0x00, 0x00, 0x00, 0x00, 
     0x00, 0x00
   };
+#endif
 
-uint8_t payload_68[] = {
+#if EF_TX_HAS(68)
+static const uint8_t payload_68[] = {
     0x4d, 0x31, 0x30, 0x32, 0x5a, 0x33, 0x42, 0x34, 
     0x5a, 0x45, 0x35, 0x48, 0x30, 0x36, 0x30, 0x31, 
     0x60, 0xea, 0x00, 0x00, 0x4d, 0x03, 0x01, 0x01, 
@@ -406,18 +395,21 @@ uint8_t payload_68[] = {
     0x16, 0x03, 0x00, 0x00, 0x54, 0xec, 0x00, 0x00, 
     0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
   };
+#endif
 
-uint8_t payload_C4[69];
 
-uint8_t payload_4F[] = {
+#if EF_TX_HAS(4F)
+static const uint8_t payload_4F[] = {
     0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFA, 0xFF, 
     0xFF, 0xFF, 0x7F, 0x32, 0x02, 0x00, 0x00, 0x64, 
     0x05, 0x00, 0x64, 0x00, 0x2C, 0x01, 0x00, 0x00, 
     0x00, 0x25, 0x00, 0xFF, 0xFF, 0x00, 0x00, 0x00, 
     0x00, 0x00, 0x00
   };
+#endif
 
-uint8_t payload_8C[] = { //Version Date
+#if EF_TX_HAS(8C)
+static const uint8_t payload_8C[] = { //Version Date
     0x3C, 0x00, 0x0B, 0x00, 0x01, 0x01, 0x03, 0x4D, 
     0x11, 0x01, 0x00, 0x01, 0x4A, 0x61, 0x6E, 0x20, 
     0x32, 0x32, 0x20, 0x32, 0x30, 0x32, 0x34, 0x20, 
@@ -425,764 +417,898 @@ uint8_t payload_8C[] = { //Version Date
     0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
     0x00, 0x00, 0x00, 0x00
   };
+#endif
 
-uint8_t payload_24[] = { //Version Date
+#if EF_TX_HAS(24)
+static const uint8_t payload_24[] = { //Version Date
     0x7E, 0x06, 0x00, 0x00, 0x3C, 0x00, 0x0B, 0x00, 
     0x4D, 0x31, 0x30, 0x32, 0x5A, 0x33, 0x42, 0x34, 
     0x5A, 0x45, 0x35, 0x48, 0x30, 0x36, 0x30, 0x31, 
     0xA6, 0xF1, 0x32, 0x33, 0x34, 0x36, 0x0B, 0x00, 
     0x39, 0x38, 0x36, 0x37
   };
+#endif
 
-// ================= Prepare functions =================
-
-
-void prepareMessage13(uint8_t *message) {
-  message[7] = config.temp;
-  message[12] = config.volt& 0xFF;
-  message[13] = (config.volt>> 8) & 0xFF;
-  message[20] = config.temp;
-  
-  message[43] = config.temp;
-  message[44] = config.temp;
-  message[45] = config.temp;
-  message[46] = config.temp;
-
-uint8_t cell_offset = 77;
-uint16_t minCellMv = 65535; // Start with highest possible
-uint16_t maxCellMv = 0;     // Start with lowest possible
 
-for (uint8_t i = 0; i < 16; i++) {
-    float cellVoltage = bms.get_cell_voltage(i);
-    uint16_t cell_mv = (uint16_t)(cellVoltage * 1000.0f); // Convert V to mV
+// ================= BMS snapshot =================
 
-    // Store in message buffer
-    message[cell_offset + i * 2]     = cell_mv & 0xFF;
-    message[cell_offset + i * 2 + 1] = (cell_mv >> 8) & 0xFF;
+// Branch-free min/max/sum over the cell array; plain integer loop the
+// compiler can vectorize.
+static void cellStats(const uint16_t *mv, uint8_t n, uint16_t &mn, uint16_t &mx, uint32_t &sum) {
+  uint16_t lo = 0xFFFF, hi = 0;
+  uint32_t acc = 0;
+  for (uint8_t i = 0; i < n; i++) {
+    const uint16_t v = mv[i];
+    lo = (v < lo) ? v : lo;
+    hi = (v > hi) ? v : hi;
+    acc += v;
+  }
+  mn = lo; mx = hi; sum = acc;
+}
 
-    // Track min and max
-    if (cell_mv < minCellMv) minCellMv = cell_mv;
-    if (cell_mv > maxCellMv) maxCellMv = cell_mv;
+void bmsSnapshotCapture(BMS &bms, BmsSnapshot &snap) {
+  for (uint8_t i = 0; i < BMS_CELLS; i++)
+    snap.cellMv[i] = (uint16_t)(bms.get_cell_voltage(i) * 1000.0f); // Convert V to mV
+  cellStats(snap.cellMv, BMS_CELLS, snap.minCellMv, snap.maxCellMv, snap.sumCellMv);
+  snap.fullChargeMv    = bms.get_0x12_full_charge_voltage();
+  snap.balanceCapacity = bms.get_balance_capacity();
 }
 
-// Store Max Cell Voltage (message[39-40])
-message[39] = maxCellMv & 0xFF;
-message[40] = (maxCellMv >> 8) & 0xFF;
+// ================= Prepare functions =================
+// Each writes the dynamic fields of one message into its overlay (`ov`).
 
-// Store Min Cell Voltage (message[41-42])
-message[41] = minCellMv & 0xFF;
-message[42] = (minCellMv >> 8) & 0xFF;
 
-int16_t outputWattInt = (int16_t)outputWatt;  // Convert float to int16_t
-int16_t inputWattInt = (int16_t)inputWatt;  // Convert float to int16_t
-  message[57] = inputWattInt & 0xFF;
-  message[58] = (inputWattInt >> 8) & 0xFF;
-  message[61] = outputWattInt & 0xFF;
-  message[62] = (outputWattInt >> 8) & 0xFF;
-  memcpy(&message[122], config.serialStr, 16);
-  message[148] = (bms.get_0x12_full_charge_voltage()) & 0xFF;
-  message[149] = ((bms.get_0x12_full_charge_voltage()) >> 8) & 0xFF;
+#if EF_TX_HAS(13)
+static_assert(sizeof(payload_13) == msg13::M::size, "payload_13 does not match msg13 schema");
+#endif
+#if EF_TX_HAS(3C)
+static_assert(sizeof(payload_3C) == msg3C::M::size, "payload_3C does not match msg3C schema");
+#endif
+#if EF_TX_HAS(0B)
+static_assert(sizeof(payload_0B) == msg0B::M::size, "payload_0B does not match msg0B schema");
+#endif
+#if EF_TX_HAS(70)
+static_assert(sizeof(payload_70) == msg70::M::size, "payload_70 does not match msg70 schema");
+#endif
+#if EF_TX_HAS(5C)
+static_assert(sizeof(payload_5C) == msg5C::M::size, "payload_5C does not match msg5C schema");
+#endif
+#if EF_TX_HAS(68)
+static_assert(sizeof(payload_68) == msg68::M::size, "payload_68 does not match msg68 schema");
+#endif
+#if EF_TX_HAS(4F)
+static_assert(sizeof(payload_4F) == msg4F::M::size, "payload_4F does not match msg4F schema");
+#endif
+#if EF_TX_HAS(24)
+static_assert(sizeof(payload_24) == msg24::M::size, "payload_24 does not match msg24 schema");
+#endif
 
+void prepareMessage13(const BridgeContext &ctx, uint8_t *ov) {
+  using namespace msg13;
+  const EcoflowConfig &config = ctx.txIn.config;
+  const BmsSnapshot &snap = ctx.bmsSnap;
+  Overlay::put<Temp>(ov, config.temp);
+  Overlay::put<Volt>(ov, config.volt);
+  Overlay::put<Temp2>(ov, config.temp);
+  Overlay::fill<CellTemps>(ov, (uint8_t)config.temp);
+
+  static_assert(CellMv::count == BMS_CELLS, "msg13 cell array must match BMS_CELLS");
+  for (uint8_t i = 0; i < BMS_CELLS; i++) Overlay::put<CellMv>(ov, i, snap.cellMv[i]);
+  Overlay::put<MaxCellMv>(ov, snap.maxCellMv);
+  Overlay::put<MinCellMv>(ov, snap.minCellMv);
+
+  Overlay::put<InputWatt>(ov, (uint16_t)(int16_t)ctx.txIn.inputWatt);
+  Overlay::put<OutputWatt>(ov, (uint16_t)(int16_t)ctx.txIn.outputWatt);
+  Overlay::put<Serial>(ov, config.serialStr);
+  Overlay::put<FullChgMv>(ov, snap.fullChargeMv);
 }
 
-void prepareMessage3C(uint8_t *message) {
-  memcpy(&message[3], config.serialStr, 16);
-  message[41] = (config.chgvolt + 3) & 0xFF;
-  message[42] = ((config.chgvolt + 3) >> 8) & 0xFF;
-  message[56] = config.soc;
-  message[57] = (config.volt) & 0xFF;
-  message[58] = ((config.volt) >> 8) & 0xFF;
-  message[114] = message[115] = config.temp;
-
-  message[120] = config.chgruntime & 0xFF;
-  message[121] = (config.chgruntime >> 8) & 0xFF;
-  message[122] = (config.chgruntime >> 16) & 0xFF;
-  message[123] = (config.chgruntime >> 24) & 0xFF;
+void prepareMessage3C(const BridgeContext &ctx, uint8_t *ov) {
+  using namespace msg3C;
+  const EcoflowConfig &config = ctx.txIn.config;
+  Overlay::put<Serial>(ov, config.serialStr);
+  Overlay::put<ChgVolt>(ov, config.chgvolt + 3);
+  Overlay::put<Soc>(ov, config.soc);
+  Overlay::put<Volt>(ov, config.volt);
+  Overlay::fill<Temps>(ov, (uint8_t)config.temp);
+  Overlay::put<ChgRuntime>(ov, config.chgruntime);
+  Overlay::put<DisRuntime>(ov, config.disruntime);
+  Overlay::put<BmsChgUp>(ov, config.bmsChgUp);
+  Overlay::put<BmsChgDn>(ov, config.bmsChgDn);
+}
 
-  message[124] = config.disruntime & 0xFF;
-  message[125] = (config.disruntime >> 8) & 0xFF;
-  message[126] = (config.disruntime >> 16) & 0xFF;
-  message[127] = (config.disruntime >> 24) & 0xFF;
+void prepareMessageEB(const BridgeContext &, uint8_t *) {
+// Nothing to prepare yet... need to work out the message structure
+}
 
-  message[128] = config.bmsChgUp;
-  message[129] = config.bmsChgDn;
+void prepareMessage0B(const BridgeContext &ctx, uint8_t *ov) {
+  using namespace msg0B;
+  const EcoflowConfig &config = ctx.txIn.config;
+  Overlay::put<VoltPlus1000>(ov, config.volt + 1000);  // Consistently +1000mV Battery Voltage
+  Overlay::put<VoltRelease>(ov, config.volt - 1896);   // Roughly - 1896, Maybe BMS release or trigger voltage?
 }
 
-void prepareMessageEB(uint8_t *message) {
-// Nothing to prepare yet... need to work out the message structure
+void prepareMessageCB(const BridgeContext &, uint8_t *) {
+  //ov[0] = config.flagCB ? 0x01 : 0x00;
 }
 
-void prepareMessage0B(uint8_t *message) {
-  message[1] = (config.volt + 1000) & 0xFF;         // Consistently +1000mV Battery Voltage
-  message[2] = ((config.volt + 1000) >> 8) & 0xFF;
+void prepareMessage70(const BridgeContext &ctx, uint8_t *ov) {
+  msg70::Overlay::put<msg70::Serial>(ov, ctx.txIn.config.serialStr);
+}
 
-  message[9] = (config.volt - 1896) & 0xFF;         //Roughly - 1896, Maybe BMS release or trigger voltage?
-  message[10] = ((config.volt - 1896) >> 8) & 0xFF; //
+void prepareMessage5C(const BridgeContext &ctx, uint8_t *ov) {
+  using namespace msg5C;
+  Overlay::put<Volt>(ov, ctx.txIn.config.volt);
+  Overlay::put<Flag>(ov, 0x00);
 }
 
-void prepareMessageCB(uint8_t *message) {
-  //message[0] = config.flagCB ? 0x01 : 0x00;
+void prepareMessage68(const BridgeContext &ctx, uint8_t *ov) {
+  using namespace msg68;
+  const EcoflowConfig &config = ctx.txIn.config;
+  const BmsSnapshot &snap = ctx.bmsSnap;
+  int16_t outputWattInt = (int16_t)ctx.txIn.outputWatt;  // Convert float to int16_t
+  int16_t inputWattInt = (int16_t)ctx.txIn.inputWatt;  // Convert float to int16_t
+  Overlay::put<Serial>(ov, config.serialStr);
+  Overlay::put<Soc>(ov, config.soc);
+  Overlay::put<Volt>(ov, config.volt);
+  Overlay::put<Temp>(ov, config.temp);
+  Overlay::put<Charging>(ov, (inputWattInt > 0) ? 0x02 : 0x00);
+  int16_t balanceCapInt = (int16_t)snap.balanceCapacity;  // Convert float to int16_t
+  Overlay::put<BalanceCap>(ov, balanceCapInt * 1000);
+  Overlay::put<MaxCellMv>(ov, snap.maxCellMv);
+  Overlay::put<MinCellMv>(ov, snap.minCellMv);
+
+  Overlay::put<InputWatt>(ov, (uint16_t)inputWattInt);
+  Overlay::put<OutputWatt>(ov, (uint16_t)outputWattInt);
+  Overlay::put<DisRuntime>(ov, config.disruntime);
+  Overlay::put<BmsChgUp>(ov, config.bmsChgUp);
+  Overlay::put<BmsChgDn>(ov, config.bmsChgDn);
 }
 
-void prepareMessage70(uint8_t *message) {
-  memcpy(&message[1], config.serialStr, 16);
+void prepareMessage4F(const BridgeContext &ctx, uint8_t *ov) {
+  using namespace msg4F;
+  const EcoflowConfig &config = ctx.txIn.config;
+  int32_t outputWattInt = (int32_t)ctx.txIn.outputWatt;
+  int32_t inputWattInt  = (int32_t)ctx.txIn.inputWatt;
+  Overlay::put<Soc>(ov, config.soc);
+  Overlay::put<Charging>(ov, (inputWattInt > 0) ? 0x02 : 0x00);
+  Overlay::put<InputWatt>(ov, (uint32_t)inputWattInt);
+  Overlay::put<OutputWatt>(ov, (uint32_t)outputWattInt);
+  Overlay::put<ChgRuntime>(ov, config.chgruntime);
+  Overlay::put<BmsChgUp>(ov, config.bmsChgUp);
+  Overlay::put<BmsChgDn>(ov, config.bmsChgDn);
 }
 
-void prepareMessage5C(uint8_t *message) {
-  message[2] = (config.volt) & 0xFF;
-  message[3] = ((config.volt) >> 8) & 0xFF;
-  message[4] = 0x00;
+void prepareMessage8C(const BridgeContext &, uint8_t *) {
+// Nothing to prepare yet... need to work out the message structure
 }
 
-void prepareMessage68(uint8_t *message) {
-  int16_t outputWattInt = (int16_t)outputWatt;  // Convert float to int16_t
-  int16_t inputWattInt = (int16_t)inputWatt;  // Convert float to int16_t
-  memcpy(&message[0], config.serialStr, 16);
-  message[37] = config.soc;
-  message[38] = (config.volt) & 0xFF;
-  message[39] = ((config.volt) >> 8) & 0xFF;
-  message[46] = config.temp;
-  if(inputWattInt > 0) message[47] = 0x02; else message[47] = 0x00;
-  int16_t balanceCapInt = (int16_t)bms.get_balance_capacity();  // Convert float to int16_t
-  message[57] = (balanceCapInt * 1000) & 0xFF;
-  message[58] = ((balanceCapInt * 1000) >> 8) & 0xFF;
+void prepareMessage24(const BridgeContext &ctx, uint8_t *ov) {
+  msg24::Overlay::put<msg24::Serial>(ov, ctx.txIn.config.serialStr);
+}
 
-//uint8_t cell_offset = 77;
-uint16_t minCellMv = 65535; // Start with highest possible
-uint16_t maxCellMv = 0;     // Start with lowest possible
+// ================= Prepared payloads =================
+// prepareMessageXX writes only the overlay fields of each payload, which costs
+// less than the XOR and CRC every send redoes over the whole message, so they
+// run before every send. BMS reads may be locked/UART-backed: sampled once
+// per sequencer cycle into ctx.bmsSnap.
+
+// Without the TX task every TX path runs on the thread that writes config
+// and watts, so it takes them itself; with it, only the writer publishes
+static void txSyncInputs(BridgeContext &ctx) {
+#ifdef EF_PS_TX_TASK
+  (void)ctx;
+#else
+  bridgePublishInputs(ctx);
+#endif
+}
 
-for (uint8_t i = 0; i < 16; i++) {
-    float cellVoltage = bms.get_cell_voltage(i);
-    uint16_t cell_mv = (uint16_t)(cellVoltage * 1000.0f); // Convert V to mV
+static void refreshInputsBms(BridgeContext &ctx) {
+  bmsSnapshotCapture(*ctx.bms, ctx.bmsSnap);
+}
 
-    // Store in message buffer
-  //  message[cell_offset + i * 2]     = cell_mv & 0xFF;
-  //  message[cell_offset + i * 2 + 1] = (cell_mv >> 8) & 0xFF;
+static void encodeMessage(BridgeContext &ctx, uint8_t xor_key, const uint8_t *header, size_t headerSize,
+                          const uint8_t *tmpl, size_t payloadSize,
+                          const uint8_t *overlay, const schema::Span *spans, size_t spanCount);
 
-    // Track min and max
-    if (cell_mv < minCellMv) minCellMv = cell_mv;
-    if (cell_mv > maxCellMv) maxCellMv = cell_mv;
+// Template with this bridge's overlay merged in
+template <class O, size_t H, size_t P>
+static void sendOverlay(BridgeContext &ctx, const uint8_t (&header)[H], const uint8_t (&tmpl)[P],
+                        const uint8_t *overlay) {
+  sendCANMessage(ctx, header, H, tmpl, P, overlay, O::spans, sizeof(O::spans) / sizeof(O::spans[0]));
 }
-message[65] = maxCellMv & 0xFF;
-message[66] = (maxCellMv >> 8) & 0xFF;
-message[69] = minCellMv & 0xFF;
-message[70] = (minCellMv >> 8) & 0xFF;
 
+// Same for a reply, encoded with the key of the request it answers
+template <class O, size_t H, size_t P>
+static void sendReplyOverlay(BridgeContext &ctx, uint8_t key, const uint8_t (&header)[H],
+                             const uint8_t (&tmpl)[P], const uint8_t *overlay) {
+  encodeMessage(ctx, key, header, H, tmpl, P, overlay, O::spans, sizeof(O::spans) / sizeof(O::spans[0]));
+}
 
-  message[78] = inputWattInt & 0xFF;
-  message[79] = (inputWattInt >> 8) & 0xFF;
-  message[82] = outputWattInt & 0xFF;
-  message[83] = (outputWattInt >> 8) & 0xFF;
+// ================= Wrapper functions =================
 
-  message[86] = config.disruntime & 0xFF;
-  message[87] = (config.disruntime >> 8) & 0xFF;
-  message[88] = (config.disruntime >> 16) & 0xFF;
-  message[89] = (config.disruntime >> 24) & 0xFF;
+#if EF_TX_HAS(3C)
+void ecoflowSend3C(BridgeContext &ctx, uint8_t key) {
+  prepareMessage3C(ctx, ctx.payload.p3C);
+  sendReplyOverlay<msg3C::Overlay>(ctx, key, header_3C, payload_3C, ctx.payload.p3C);
+}
+#endif
 
-  message[91] = config.bmsChgUp;
-  message[92] = config.bmsChgDn;
+#if EF_TX_HAS(8C)
+void ecoflowSend8C(BridgeContext &ctx, uint8_t key) {
+  encodeMessage(ctx, key, header_8C, sizeof(header_8C), payload_8C, sizeof(payload_8C), nullptr, nullptr, 0);
 }
+#endif
 
-void prepareMessage4F(uint8_t *message) {
-int32_t outputWattInt = (int32_t)outputWatt;
-int32_t inputWattInt  = (int32_t)inputWatt;
-  // Convert float to int16_t
-  message[0] = config.soc;
-  if(inputWattInt > 0) message[1] = 0x02; else message[1] = 0x00;
-  message[2] = inputWattInt & 0xFF;
-  message[3] = (inputWattInt >> 8) & 0xFF;
-  message[4] = (inputWattInt >> 16) & 0xFF;
-  message[5] = (inputWattInt >> 24) & 0xFF;
-  message[6] = outputWattInt & 0xFF;
-  message[7] = (outputWattInt >> 8) & 0xFF;
-  message[8] = (outputWattInt >> 16) & 0xFF;
-  message[9] = (outputWattInt >> 24) & 0xFF;
-  message[10] = config.chgruntime & 0xFF;
-  message[11] = (config.chgruntime >> 8) & 0xFF;
-  message[12] = (config.chgruntime >> 16) & 0xFF;
-  message[13] = (config.chgruntime >> 24) & 0xFF;
-  message[15] = config.bmsChgUp;
-  message[16] = config.bmsChgDn;
+#if EF_TX_HAS(24)
+void ecoflowSend24(BridgeContext &ctx, uint8_t key) {
+  prepareMessage24(ctx, ctx.payload.p24);
+  sendReplyOverlay<msg24::Overlay>(ctx, key, header_24, payload_24, ctx.payload.p24);
 }
+#endif
 
-void prepareMessage8C(uint8_t *message) {
-// Nothing to prepare yet... need to work out the message structure
+#if EF_TX_HAS(CB)
+// Ack of a CB 0x2031/0x2033 limit write, same tracker as the request
+void ecoflowSendCBAck(BridgeContext &ctx, uint8_t key, uint16_t tracker) {
+  const uint8_t *header = (tracker == 0x2033) ? header_CB_2033 : header_CB_2031;
+  encodeMessage(ctx, key, header, sizeof(header_CB_2031), payload_CB, sizeof(payload_CB), nullptr, nullptr, 0);
 }
+#endif
 
-void prepareMessage24(uint8_t *message) {
-  memcpy(&message[8], config.serialStr, 16);
+// ================= TX priority: protocol replies =================
+// Replies to C4/DE/CB are queued by the RX handler and sent at the next
+// message boundary, ahead of the periodic sequencer step. Whole messages are
+// sent under the TX lock, so a multi-frame message is never split.
+
+static RequestType requestOf(uint8_t kind) {
+  switch (kind) {
+    case TX_REPLY_3C:     return RR_C4;
+    case TX_REPLY_8C:
+    case TX_REPLY_24:     return RR_DE;
+    default:              return RR_CB;
+  }
 }
 
-// ================= Wrapper functions =================
+void txQueueReply(BridgeContext &ctx, TxReply kind, uint8_t key, uint16_t tracker, uint32_t requestUs) {
+  PendingReply r = {(uint8_t)kind, key, tracker, nowMs(), requestUs};
+  if (!ctx.replyQueue.push(r)) {
+    ctx.replyStats[kind].dropped++;
+    ctx.metrics.inc(MET_TX_REPLY_DROPS);
+  }
+}
 
-void ecoflowSend3C() {
-  prepareMessage3C(payload_3C);
-  sendCANMessage(header_3C, payload_3C, sizeof(header_3C), sizeof(payload_3C));
-}
-
-void ecoflowSend8C() {
-  prepareMessage8C(payload_8C);
-  sendCANMessage(header_8C, payload_8C, sizeof(header_8C), sizeof(payload_8C));
-}
-
-void ecoflowSend24() {
-  prepareMessage24(payload_24);
-  sendCANMessage(header_24, payload_24, sizeof(header_24), sizeof(payload_24));
-}
-
-void ecoflowSendCB2031() {
-  prepareMessageCB(payload_CB);
-  sendCANMessage(header_CB_2031, payload_CB, sizeof(header_CB_2031), sizeof(payload_CB));
-}
-
-void ecoflowSendCB2033() {
-  prepareMessageCB(payload_CB);
-  sendCANMessage(header_CB_2033, payload_CB, sizeof(header_CB_2033), sizeof(payload_CB));
-}
-
-
-// ================= CRC helper =================
-
-uint16_t crc16(const uint8_t *data, uint16_t len) {
-  static const uint16_t table[] = {
-      0, 49345, 49537, 320, 49921, 960, 640, 49729,
-      50689, 1728, 1920, 51009, 1280, 50625, 50305, 1088,
-      52225, 3264, 3456, 52545, 3840, 53185, 52865, 3648,
-      2560, 51905, 52097, 2880, 51457, 2496, 2176, 51265,
-      55297, 6336, 6528, 55617, 6912, 56257, 55937, 6720,
-      7680, 57025, 57217, 8000, 56577, 7616, 7296, 56385,
-      5120, 54465, 54657, 5440, 55041, 6080, 5760, 54849,
-      53761, 4800, 4992, 54081, 4352, 53697, 53377, 4160,
-      61441, 12480, 12672, 61761, 13056, 62401, 62081, 12864,
-      13824, 63169, 63361, 14144, 62721, 13760, 13440, 62529,
-      15360, 64705, 64897, 15680, 65281, 16320, 16000, 65089,
-      64001, 15040, 15232, 64321, 14592, 63937, 63617, 14400,
-      10240, 59585, 59777, 10560, 60161, 11200, 10880, 59969,
-      60929, 11968, 12160, 61249, 11520, 60865, 60545, 11328,
-      58369, 9408, 9600, 58689, 9984, 59329, 59009, 9792,
-      8704, 58049, 58241, 9024, 57601, 8640, 8320, 57409,
-      40961, 24768, 24960, 41281, 25344, 41921, 41601, 25152,
-      26112, 42689, 42881, 26432, 42241, 26048, 25728, 42049,
-      27648, 44225, 44417, 27968, 44801, 28608, 28288, 44609,
-      43521, 27328, 27520, 43841, 26880, 43457, 43137, 26688,
-      30720, 47297, 47489, 31040, 47873, 31680, 31360, 47681,
-      48641, 32448, 32640, 48961, 32000, 48577, 48257, 31808,
-      46081, 29888, 30080, 46401, 30464, 47041, 46721, 30272,
-      29184, 45761, 45953, 29504, 45313, 29120, 28800, 45121,
-      20480, 37057, 37249, 20800, 37633, 21440, 21120, 37441,
-      38401, 22208, 22400, 38721, 21760, 38337, 38017, 21568,
-      39937, 23744, 23936, 40257, 24320, 40897, 40577, 24128,
-      23040, 39617, 39809, 23360, 39169, 22976, 22656, 38977,
-      34817, 18624, 18816, 35137, 19200, 35777, 35457, 19008,
-      19968, 36545, 36737, 20288, 36097, 19904, 19584, 35905,
-      17408, 33985, 34177, 17728, 34561, 18368, 18048, 34369,
-      33281, 17088, 17280, 33601, 16640, 33217, 32897, 16448};
-  uint16_t crc = 0;
-  for (uint16_t i = 0; i < len; i++) {
-    crc = table[((crc ^ data[i]) & 0xFF)] ^ (crc >> 8);
+void txPumpReplies(BridgeContext &ctx) {
+  EF_TX_GUARD(ctx);
+  txSyncInputs(ctx);
+  PendingReply r;
+  while (ctx.replyQueue.pop(r)) {
+    switch (r.kind) {
+#if EF_TX_HAS(3C)
+      case TX_REPLY_3C:     ecoflowSend3C(ctx, r.key); break;
+#endif
+#if EF_TX_HAS(8C)
+      case TX_REPLY_8C:     ecoflowSend8C(ctx, r.key); break;
+#endif
+#if EF_TX_HAS(24)
+      case TX_REPLY_24:     ecoflowSend24(ctx, r.key); break;
+#endif
+#if EF_TX_HAS(CB)
+      case TX_REPLY_CB2031:
+      case TX_REPLY_CB2033: ecoflowSendCBAck(ctx, r.key, r.tracker); break;
+#endif
+      default: continue;
+    }
+    // last frame of the reply has been handed to the driver
+    ctx.rrLatency[requestOf(r.kind)].record(EF_MICROS() - r.requestUs);
+
+    TxReplyStats &st = ctx.replyStats[r.kind];
+    const uint32_t lat = nowMs() - r.queuedMs;
+    st.count++;
+    st.lastMs = lat;
+    st.sumMs += lat;
+    if (lat > st.maxMs) st.maxMs = lat;
   }
-  return crc;
 }
 
 // ================= sendCANMessage =================
-void sendCANMessage(uint8_t* header, uint8_t* payload, size_t headerSize, size_t payloadSize) {
 
-  #define IDX_TRK0   16  // tracker = last 4 header bytes
-  #define IDX_TRK1   17
+// FrameEncoder sink: put one frame on the bridge's bus, optionally logging it
+static void txFrame(void *arg, uint32_t id, const uint8_t *data, uint8_t len) {
+  BridgeContext &ctx = *static_cast<BridgeContext *>(arg);
+  ctx.send(ctx.sendArg, id, data, len);
+  ctx.metrics.inc(MET_TX_FRAMES);
+  ctx.busLoad.record(BUS_TX, ctx.txMsgType, id, true, data, len, EF_MILLIS());
+  if (ctx.txIn.config.txlogging) canLog.push(CAN_LOG_TX, ctx.index, EF_MILLIS(), id, data, len);
+}
+
+void sendCANMessage(BridgeContext &ctx, const uint8_t *header, const uint8_t *payload,
+                    size_t headerSize, size_t payloadSize) {
+  sendCANMessage(ctx, header, headerSize, payload, payloadSize, nullptr, nullptr, 0);
+}
 
-  if (!header || headerSize < 7) { streamDebug("sendCANMessage: bad header"); return; }
+void sendCANMessage(BridgeContext &ctx, const uint8_t *header, size_t headerSize,
+                    const uint8_t *tmpl, size_t payloadSize,
+                    const uint8_t *overlay, const schema::Span *spans, size_t spanCount) {
+  EF_TX_GUARD(ctx);
+  txSyncInputs(ctx);
 
-  // Message type (5th byte) selects ID set and framing mode
+  if (!header || headerSize < MSG14001_HDR_LEN) { streamDebug("sendCANMessage: bad header"); return; }
+
+  // Message type (5th byte) and tracker select the XOR key
   const uint8_t msg_type = header[4];
 
     uint8_t  t0 = header[16], t1 = header[17];
     uint16_t trackerBE = ((uint16_t)t0 << 8) | (uint16_t)t1;
 
-  uint32_t id_first, id_middle, id_last;
-  const bool use_length_byte = (msg_type == 0xA0);
-
    uint8_t xor_key;
 
-    id_first  = 0x10003001;
-    id_middle = 0x10103001;
-    id_last   = 0x10203001;
-
   if (msg_type == 0x3C) {
-    xor_key = xor3C;
+    xor_key = ctx.xor3C;
   } else if (msg_type == 0x8C) {
-    xor_key = xor8C;
+    xor_key = ctx.xor8C;
   } else if (msg_type == 0x24) {
-    xor_key = xor24;
+    xor_key = ctx.xor24;
   } else if (msg_type == 0xCB) {
     if (trackerBE == 0x2031 || trackerBE == 0x2033) {
-      xor_key = xorCB; 
-    } else xor_key = xorCounter++;
+      xor_key = ctx.xorCB;
+    } else xor_key = ctx.xorCounter++;
   } else {
-      xor_key = xorCounter++;
+      xor_key = ctx.xorCounter++;
     }
 
-  // ALWAYS generate a new XOR key and write it into header[6]
-  header[6] = xor_key;
-
-  // Encode payload (safe if payload == nullptr)
-  uint8_t encoded[(payloadSize > 0) ? payloadSize : 1];
-  for (size_t i = 0; i < payloadSize; i++) {
-    uint8_t src = payload ? payload[i] : 0x00;
-    encoded[i] = src ^ xor_key;
-  }
-
-  // Build final message: header + encoded payload + CRC(LE, unencoded)
-  uint8_t crc_buf[headerSize + payloadSize];
-  memcpy(crc_buf, header, headerSize);
-  if (payloadSize) memcpy(crc_buf + headerSize, encoded, payloadSize);
-  uint16_t crc = crc16(crc_buf, headerSize + payloadSize);
-
-  uint8_t final_msg[headerSize + payloadSize + 2];
-  memcpy(final_msg, crc_buf, headerSize + payloadSize);
-  final_msg[headerSize + payloadSize]     = (uint8_t)(crc & 0xFF);
-  final_msg[headerSize + payloadSize + 1] = (uint8_t)(crc >> 8);
-
-  const size_t total = sizeof(final_msg);
-  char logBuffer[128];
+  encodeMessage(ctx, xor_key, header, headerSize, tmpl, payloadSize, overlay, spans, spanCount);
+}
 
-  // --- Framing & TX ---
+static void encodeMessage(BridgeContext &ctx, uint8_t xor_key, const uint8_t *header, size_t headerSize,
+                          const uint8_t *tmpl, size_t payloadSize,
+                          const uint8_t *overlay, const schema::Span *spans, size_t spanCount) {
+  // Message type (5th byte) selects framing mode
+  const uint8_t msg_type = header[4];
+  const bool use_length_byte = (msg_type == 0xA0);
+  const uint32_t id_first = 0x10003001, id_middle = 0x10103001, id_last = 0x10203001;
+
+  // Single pass: header with the fresh XOR key at [6], payload XOR-encoded,
+  // CRC(LE) over both, emitted frame by frame from an 8-byte staging buffer.
+  // Header and payload templates are only read, so they can live in flash and
+  // be shared by all bridges; the payload is the template with each span
+  // taken from the overlay instead.
+  ctx.txMsgType = msg_type;
+  ctx.metrics.inc(MET_TX_MESSAGES);
+  FrameEncoder enc(id_first, id_middle, id_last, use_length_byte, txFrame, &ctx);
+  enc.write(header, 6);
+  enc.write(&xor_key, 1);
+  enc.write(header + 7, headerSize - 7);
   size_t pos = 0;
-  size_t frame_idx = 0;
-
-  while (pos < total) {
-    size_t remain = total - pos;
-
-    if (!use_length_byte) {
-      // 13/49 etc: raw 8B frames
-      uint8_t chunk = (remain > 8) ? 8 : (uint8_t)remain;
-      bool is_last  = (remain <= 8);
-      uint32_t id   = (frame_idx == 0) ? id_first : (is_last ? id_last : id_middle);
-
-      sendCANFrame(id, &final_msg[pos], chunk);
-      if (config.txlogging) {
-        char buf[64];
-        int n = snprintf(buf, sizeof(buf), "TX 0x%lX: ", (unsigned long)id);
-        canLog.append(buf, (n > 0) ? n : 0);
-        for (uint8_t j = 0; j < chunk; j++) {
-          if (final_msg[pos + j] < 0x10) canLog.push_back('0');
-          int m = snprintf(buf, sizeof(buf), "%02X", final_msg[pos + j]);
-          canLog.append(buf, (m > 0) ? m : 0);
-          if (j + 1 < chunk) canLog.push_back(' ');
-        }
-        canLog += "<br>";
-      }
-      pos += chunk;
-
-    } else {
-      // A0: [len][<=7 data] → DLC = len + 1
-      uint8_t chunk = (remain > 7) ? 7 : (uint8_t)remain;
-      if (chunk == 0) break;
-
-      uint8_t frame_bytes[8];
-      frame_bytes[0] = chunk;                       // length of following bytes
-      memcpy(&frame_bytes[1], &final_msg[pos], chunk);
-
-      bool is_last  = (remain <= 7);
-      uint32_t id   = (frame_idx == 0) ? id_first : (is_last ? id_last : id_middle);
-
-      sendCANFrame(id, frame_bytes, (uint8_t)(chunk + 1));
-    if (config.txlogging) {
-      char buf[64];
-      int n = snprintf(buf, sizeof(buf), "TX 0x%lX: ", (unsigned long)id);
-      canLog.append(buf, (n > 0) ? n : 0);
-      for (uint8_t j = 0; j < (uint8_t)(chunk + 1); j++) {
-        if (frame_bytes[j] < 0x10) canLog.push_back('0');
-        int m = snprintf(buf, sizeof(buf), "%02X", frame_bytes[j]);
-        canLog.append(buf, (m > 0) ? m : 0);
-        if (j + 1 < (uint8_t)(chunk + 1)) canLog.push_back(' ');
-      }
-      canLog += "<br>";
-    }
-      pos += chunk;
-    }
-
-    frame_idx++;
-    // vTaskDelay(1);   // remove this hard delay
-    // tiny cooperative yield every 4 frames (platform-specific); noop here
+  for (size_t i = 0; i < spanCount && spans[i].offset + spans[i].len <= payloadSize; i++) {
+    enc.writeXor(tmpl ? tmpl + pos : nullptr, spans[i].offset - pos, xor_key);
+    enc.writeXor(overlay, spans[i].len, xor_key);
+    overlay += spans[i].len;
+    pos = spans[i].offset + spans[i].len;
   }
+  enc.writeXor(tmpl ? tmpl + pos : nullptr, payloadSize - pos, xor_key);
+  enc.finish();
 }
 
 // ================= Sequencer =================
 
-void canSequencer_onHeartbeatC4() {
-  g_lastC4ms = EF_MILLIS();
-  if (!g_seqRunning) {
-    g_seqRunning = true;
-    g_seqIndex   = 0;
-    g_nextDueMs  = EF_MILLIS();   // start immediately
-    canHealth = true;
+void canSequencer_onHeartbeatC4(BridgeContext &ctx) {
+  EF_TX_GUARD(ctx);
+  ctx.lastC4ms = nowMs();
+  if (!ctx.seqRunning) {
+    ctx.seqRunning = true;
+    ctx.seqIndex   = 0;
+    ctx.nextDueMs  = ctx.lastC4ms;   // start immediately
+    ctx.cycleStartValid = false;
+    ctx.canHealth = true;
   }
 }
 
-void canTxSequencerTick() {
+static constexpr uint32_t seqCycleMs() {
+  uint32_t total = 0;
+  for (uint8_t i = 0; i < kSeqCount; i++) total += kSeq[i].gap_ms;
+  return total;
+}
+static_assert(seqCycleMs() <= 0xFFFF, "kSeq cycle longer than 65535 ms");
+static constexpr uint16_t kSeqCycleMs = (uint16_t)seqCycleMs();
+
+// Record how late step `idx` ran and, at the start of each cycle, the period
+static void seqRecord(BridgeContext &ctx, uint8_t idx, uint32_t now, uint32_t lateMs) {
+  SeqStepStats &st = ctx.seqStats.step[idx];
+  uint8_t b = 0;
+  while (b + 1 < EF_SEQ_LATE_BUCKETS && (lateMs >> b) != 0) b++;
+  st.hist[b]++;
+  st.count++;
+  st.lateSumMs += lateMs;
+  if (lateMs > st.lateMaxMs) st.lateMaxMs = lateMs;
+
+  if (idx != 0) return;
+  if (ctx.cycleStartValid) {
+    CycleStats &c = ctx.seqStats.cycle;
+    const uint32_t period = now - ctx.cycleStartMs;
+    if (c.count == 0 || period < c.minMs) c.minMs = period;
+    if (period > c.maxMs) c.maxMs = period;
+    c.lastMs = period;
+    c.sumMs += period;
+    c.count++;
+  }
+  ctx.cycleStartMs = now;
+  ctx.cycleStartValid = true;
+}
+
+uint32_t canTxSequencerTick(BridgeContext &ctx) {
+  EF_TX_GUARD(ctx);
+  txSyncInputs(ctx);
+  // replies first: they preempt the periodic schedule at message boundaries
+  txPumpReplies(ctx);
+  uint32_t now = nowMs();
+
   // stop if heartbeat lost
-  if (g_seqRunning && (EF_MILLIS() - g_lastC4ms > C4_LOSS_TIMEOUT_MS)) {
-    g_seqRunning = false;
-    canHealth = false;
+  if (ctx.seqRunning && (now - ctx.lastC4ms > C4_LOSS_TIMEOUT_MS)) {
+    ctx.seqRunning = false;
+    ctx.canHealth = false;
   }
-  if (!g_seqRunning || !config.canTxEnabled) return;
+  if (!ctx.seqRunning || !ctx.txIn.config.canTxEnabled) return EF_SEQ_IDLE;
+
+  if (!timeReached(now, ctx.nextDueMs)) return ctx.nextDueMs - now;
+  const uint32_t late = now - ctx.nextDueMs;
 
-  uint32_t now = EF_MILLIS();
-  if (now < g_nextDueMs) return;
+  // sample BMS-backed inputs once per cycle
+  if (ctx.seqIndex == 0) refreshInputsBms(ctx);
 
   // send current step
-  const Step& step = kSeq[g_seqIndex];
-  sendAction(step.act);
+  const Step& step = kSeq[ctx.seqIndex];
+  sendAction(ctx, step.act);
+  seqRecord(ctx, ctx.seqIndex, now, late);
+
+  // schedule next from the deadline, not from `now`, so lateness does not
+  // accumulate across the cycle. After a stall longer than a whole cycle,
+  // re-anchor instead of bursting through the backlog.
+  ctx.nextDueMs += step.gap_ms;
+  if (late > kSeqCycleMs) {
+    ctx.nextDueMs = now + step.gap_ms;
+    ctx.seqStats.resyncs++;
+  }
+  ctx.seqIndex = (uint8_t)((ctx.seqIndex + 1) % kSeqCount);
+
+  now = nowMs();
+  return timeReached(now, ctx.nextDueMs) ? 0 : ctx.nextDueMs - now;
+}
 
-  // schedule next
-  g_nextDueMs = now + step.gap_ms;
-  g_seqIndex = (uint8_t)((g_seqIndex + 1) % kSeqCount);
+const SeqStats &sequencerStats(BridgeContext &ctx) {
+  ctx.seqStats.steps = kSeqCount;
+  ctx.seqStats.nominalCycleMs = kSeqCycleMs;
+  return ctx.seqStats;
 }
 
 // ================= Send action dispatcher =================
 
-static void sendAction(TxAction a) {
-  if (!config.canTxEnabled) return;
+#if EF_TX_HAS(0B)
+// The five 0B variants share one payload and differ only in the header
+static void send0B(BridgeContext &ctx, const uint8_t (&header)[18]) {
+  if (!EF_TX_ON(ctx.txIn.config, 0B)) return;
+  BridgePayloads &pl = ctx.payload;
+  prepareMessage0B(ctx, pl.p0B);
+  sendOverlay<msg0B::Overlay>(ctx, header, payload_0B, pl.p0B);
+}
+#endif
+
+static void sendAction(BridgeContext &ctx, TxAction a) {
+  const EcoflowConfig &config = ctx.txIn.config;
+  BridgePayloads &pl = ctx.payload;
+  (void)config; (void)pl;
 
+  // canTxEnabled was checked by the tick; only built-in messages have a case
   switch (a) {
+#if EF_TX_HAS(70)
     case A_70:
-      if (config.message70) {
-        prepareMessage70(payload_70);
-        sendCANMessage(header_70, payload_70, sizeof(header_70), sizeof(payload_70));
+      if (EF_TX_ON(config, 70)) {
+        prepareMessage70(ctx, pl.p70);
+        sendOverlay<msg70::Overlay>(ctx, header_70, payload_70, pl.p70);
       }
       break;
+#endif
 
-    case A_0B_04:
-      if (config.message0B) {
-        prepareMessage0B(payload_0B);
-        sendCANMessage(header_0B_04, payload_0B, sizeof(header_0B_04), sizeof(payload_0B));
-      }
-      break;
-    case A_0B_02:
-      if (config.message0B) {
-        prepareMessage0B(payload_0B);
-        sendCANMessage(header_0B_02, payload_0B, sizeof(header_0B_02), sizeof(payload_0B));
-      }
-      break;
-    case A_0B_05:
-      if (config.message0B) {
-        prepareMessage0B(payload_0B);
-        sendCANMessage(header_0B_05, payload_0B, sizeof(header_0B_05), sizeof(payload_0B));
-      }
-      break;
-    case A_0B_50:
-      if (config.message0B) {
-        prepareMessage0B(payload_0B);
-        sendCANMessage(header_0B_50, payload_0B, sizeof(header_0B_50), sizeof(payload_0B));
-      }
-      break;
-    case A_0B_08:
-      if (config.message0B) {
-        prepareMessage0B(payload_0B);
-        sendCANMessage(header_0B_08, payload_0B, sizeof(header_0B_08), sizeof(payload_0B));
-      }
-      break;
+#if EF_TX_HAS(0B)
+    case A_0B_04: send0B(ctx, header_0B_04); break;
+    case A_0B_02: send0B(ctx, header_0B_02); break;
+    case A_0B_05: send0B(ctx, header_0B_05); break;
+    case A_0B_50: send0B(ctx, header_0B_50); break;
+    case A_0B_08: send0B(ctx, header_0B_08); break;
+#endif
 
+#if EF_TX_HAS(4F)
     case A_4F:
-      if (config.message4F) {
-        prepareMessage4F(payload_4F);
-        sendCANMessage(header_4F, payload_4F, sizeof(header_4F), sizeof(payload_4F));
+      if (EF_TX_ON(config, 4F)) {
+        prepareMessage4F(ctx, pl.p4F);
+        sendOverlay<msg4F::Overlay>(ctx, header_4F, payload_4F, pl.p4F);
       }
       break;
+#endif
 
+#if EF_TX_HAS(68)
     case A_68:
-      if (config.message68) {
-        prepareMessage68(payload_68);
-        sendCANMessage(header_68, payload_68, sizeof(header_68), sizeof(payload_68));
+      if (EF_TX_ON(config, 68)) {
+        prepareMessage68(ctx, pl.p68);
+        sendOverlay<msg68::Overlay>(ctx, header_68, payload_68, pl.p68);
       }
       break;
+#endif
 
+#if EF_TX_HAS(13)
     case A_13:
-      if (config.message13) {
-        prepareMessage13(payload_13);
-        sendCANMessage(header_13, payload_13, sizeof(header_13), sizeof(payload_13));
+      if (EF_TX_ON(config, 13)) {
+        prepareMessage13(ctx, pl.p13);
+        sendOverlay<msg13::Overlay>(ctx, header_13, payload_13, pl.p13);
       }
       break;
+#endif
 
+#if EF_TX_HAS(CB)
     case A_CB_321:
-      if (config.messageCB) {
-        prepareMessageCB(payload_CB);
-        sendCANMessage(header_CB_321, payload_CB, sizeof(header_CB_321), sizeof(payload_CB));
+      if (EF_TX_ON(config, CB)) {
+        sendCANMessage(ctx, header_CB_321, payload_CB, sizeof(header_CB_321), sizeof(payload_CB));
       }
       break;
 
     case A_CB_141:
-      if (config.messageCB) {
-        prepareMessageCB(payload_CB);
-        sendCANMessage(header_CB_141, payload_CB, sizeof(header_CB_141), sizeof(payload_CB));
+      if (EF_TX_ON(config, CB)) {
+        sendCANMessage(ctx, header_CB_141, payload_CB, sizeof(header_CB_141), sizeof(payload_CB));
       }
       break;
 
-    case A_5C:
-      if (config.message5C) {
-        prepareMessage5C(payload_5C);
-        sendCANMessage(header_5C, payload_5C, sizeof(header_5C), sizeof(payload_5C));
+    case A_CB_150:
+      if (EF_TX_ON(config, CB)) {
+        sendCANMessage(ctx, header_CB_150, payload_CB, sizeof(header_CB_150), sizeof(payload_CB));
       }
       break;
+#endif
 
-    case A_CB_150:
-      if (config.messageCB) {
-        prepareMessageCB(payload_CB);
-        sendCANMessage(header_CB_150, payload_CB, sizeof(header_CB_150), sizeof(payload_CB));
+#if EF_TX_HAS(5C)
+    case A_5C:
+      if (EF_TX_ON(config, 5C)) {
+        prepareMessage5C(ctx, pl.p5C);
+        sendOverlay<msg5C::Overlay>(ctx, header_5C, payload_5C, pl.p5C);
       }
       break;
+#endif
+
+    default:
+      break;
   }
 }
 
+// ================= Bridge registry =================
+
+static BridgeContext *g_bridges = nullptr;
+
+#ifdef EF_PS_TX_TASK
+// setup() of a later ef_ps may register its bridge while the TX task is
+// already walking the list in bridgeTickAll()
+static std::mutex g_bridgesMutex;
+#define EF_REGISTRY_GUARD() std::lock_guard<std::mutex> registryGuard_(g_bridgesMutex)
+#else
+#define EF_REGISTRY_GUARD() do {} while (0)
+#endif
+
+void bridgeInit(BridgeContext &ctx, EcoflowConfig *config, BMS *bms,
+                const float *inputWatt, const float *outputWatt,
+                BridgeSendFn send, void *sendArg) {
+  EF_REGISTRY_GUARD();
+  ctx.config     = config;
+  ctx.bms        = bms;
+  ctx.inputWatt  = inputWatt;
+  ctx.outputWatt = outputWatt;
+  ctx.send       = send;
+  ctx.sendArg    = sendArg;
+  ctx.xorCounter = (uint8_t)(rand() & 0xFF);
+  ctx.rx14001.setMetrics(&ctx.metrics);
+  bridgePublishInputs(ctx);
+
+  // append, so the default bridge stays first (index 0)
+  BridgeContext **tail = &g_bridges;
+  uint8_t index = 0;
+  while (*tail && *tail != &ctx) { tail = &(*tail)->next; index++; }
+  if (!*tail) *tail = &ctx;
+  ctx.index = index;
+}
+
+void bridgePublishInputs(BridgeContext &ctx) {
+  EF_TX_GUARD(ctx);
+  ctx.txIn.config     = *ctx.config;
+  ctx.txIn.inputWatt  = *ctx.inputWatt;
+  ctx.txIn.outputWatt = *ctx.outputWatt;
+}
+
+BridgeContext *bridgeFirst() {
+  return g_bridges;
+}
+
+uint32_t bridgeTickAll() {
+  EF_REGISTRY_GUARD();
+  uint32_t wait = EF_SEQ_IDLE;
+  for (BridgeContext *c = g_bridges; c; c = c->next) {
+    const uint32_t w = canTxSequencerTick(*c);
+    if (w < wait) wait = w;
+  }
+  return wait;
+}
+
+// Legacy single-bridge binding: global config/bms/watts, global sendCANFrame()
+static void sendDefault(void *, uint32_t id, const uint8_t *data, uint8_t len) {
+  sendCANFrame(id, data, len);
+}
+
+BridgeContext &defaultBridge() {
+  static BridgeContext ctx;
+  static const bool bound =
+      (bridgeInit(ctx, &config, &bms, &inputWatt, &outputWatt, sendDefault, nullptr), true);
+  (void)bound;
+  return ctx;
+}
+
 // ================= Xor Counter Initialiser =================
 
 void ecoflowMessagesInit() {
-  xorCounter = (uint8_t)(rand() & 0xFF);
+  defaultBridge().xorCounter = (uint8_t)(rand() & 0xFF);
 }
 
 // ================= EcoFlow CAN Rx Processor =================
 
-void processEcoFlowCAN(const ef_twai_message_t &rx) {
-  uint32_t id = rx.identifier;
-  uint32_t fullID = id & 0x1FFFFFFF;
+void canBusLoad(BridgeContext &ctx, BusLoadStats &out) {
+  ctx.busLoad.snapshot(out, nowMs());
+}
 
-  // 14001 IDs
-  #define MSG14001_START_ID   0x10014001UL
-  #define MSG14001_MID_ID     0x10114001UL
-  #define MSG14001_END_ID     0x10214001UL
-
-  // Fixed parts
-  #define MSG14001_HDR_LEN    18
-  #define MSG14001_TIMEOUT_MS 300
-
-  // Header indices
-  #define IDX_TYPE   4   // msg_type
-  #define IDX_XOR    6   // XOR key (unencoded)
-  #define IDX_LEN_LO 2   // payload length (lo)
-  #define IDX_LEN_HI 3   // payload length (hi)
-  #define IDX_TRK0   16  // tracker = last 4 header bytes
-  #define IDX_TRK1   17
-
-  #ifndef MSG14001_MAX_PAYLOAD
-  #define MSG14001_MAX_PAYLOAD 2048
-  #endif
-  #define MSG14001_BUF_CAP (MSG14001_HDR_LEN + MSG14001_MAX_PAYLOAD + 2)
-
-  static uint8_t  buf[MSG14001_BUF_CAP];
-  static size_t   have = 0;
-  static bool     active = false;
-  static uint32_t lastTime = 0;
-
-  // dynamic fields for the in-progress message
-  static bool     lenKnown = false;
-  static uint16_t payloadLen = 0;
-  static size_t   targetTotal = 0; // = 18 + payloadLen + 2 once known
-
-  // monitoring
-  static uint16_t typeCount[256] = {0};
-  static uint8_t  curType = 0xFF;       static bool curTypeValid = false;
-  static uint16_t curTrackerBE = 0;     static bool curTrackerValid = false;
-  static uint8_t  lastType = 0;
-  static uint16_t lastTrackerBE = 0;
-
-  auto reset_state = [&](){
-    have = 0; active = false; lastTime = 0;
-    lenKnown = false; payloadLen = 0; targetTotal = 0;
-    curTypeValid = false; curTrackerValid = false; curType = 0xFF; curTrackerBE = 0;
-  };
+void canRxTick(BridgeContext &ctx) {
+  ctx.rx14001.expire(EF_MILLIS());
+}
 
-  auto append_bytes = [&](const uint8_t* data, uint8_t dlc){
-    if (!active || dlc == 0) return;
-    if (have + dlc > MSG14001_BUF_CAP) dlc = (uint8_t)(MSG14001_BUF_CAP - have); // clamp
-    memcpy(&buf[have], data, dlc);
-    have += dlc;
-    lastTime = EF_MILLIS();
-
-    // Capture type early
-    if (!curTypeValid && have >= (IDX_TYPE + 1)) {
-      curType = buf[IDX_TYPE];
-      curTypeValid = true;
-    }
-    // Determine payload length when we have first 4 header bytes
-    if (!lenKnown && have >= (IDX_LEN_HI + 1)) {
-      payloadLen = (uint16_t)buf[IDX_LEN_LO] | ((uint16_t)buf[IDX_LEN_HI] << 8); // little-endian
-      // Guard against oversize messages
-      if (payloadLen > MSG14001_MAX_PAYLOAD) {
-        char m[96];
-        snprintf(m, sizeof(m), "14001 oversize payload %u > cap %u — dropping",
-                 payloadLen, (unsigned)MSG14001_MAX_PAYLOAD);
-        streamDebug(m);
-        reset_state();
-        return;
-      }
-      targetTotal = (size_t)MSG14001_HDR_LEN + (size_t)payloadLen + 2U;
-      lenKnown = true;
-    }
-    // Tracker available once full header is buffered
-    if (!curTrackerValid && have >= MSG14001_HDR_LEN) {
-      curTrackerBE = ((uint16_t)buf[IDX_TRK0] << 8)  |  (uint16_t)buf[IDX_TRK1];
-      curTrackerValid = true;
+// ----- built-in RX handlers (registered below) -----
+
+static bool isPrintable(uint8_t c) { return c >= 32 && c <= 126; }
+
+// C4 heartbeat: peer serial, 3C reply, (re)start the sequencer
+static void rxOnC4(BridgeContext &ctx, const RxMessage &m, void *) {
+  const schema::View<rxC4::M> v{m.payload, m.payloadLen};
+  char serial[17] = {0};
+  bool printable = v.ok();
+  if (printable) {
+    const uint8_t *s = v.bytes<rxC4::Serial>();
+    for (size_t i = 0; i < rxC4::Serial::width; ++i) {
+      serial[i] = isPrintable(s[i]) ? (char)s[i] : '?';
+      if (!isPrintable(s[i])) printable = false;
     }
-  };
+  }
 
-  auto is_printable = [](uint8_t c){ return (c >= 32 && c <= 126); };
+  if (printable) {
+    strncpy(ctx.serialPS, serial, sizeof(ctx.serialPS) - 1);
+    ctx.serialPS[sizeof(ctx.serialPS) - 1] = '\0';
+  } else {
+    ctx.serialPS[0] = '\0'; // invalid / missing → clear
+  }
 
-  auto try_finish = [&](){
-    if (!active || !lenKnown) return false;
-    if (have < targetTotal)   return false;
+  char dbg[256];
+  snprintf(dbg, sizeof(dbg),
+           "14001 OK type=C4 len=%u cnt=%u XOR=0x%02X CRC=%04X tracker=%04X serial=%s%s",
+           m.payloadLen, (unsigned)m.typeCount, m.key, m.crc, m.tracker,
+           serial, printable ? "" : " (non-printable/missing)");
+  streamDebug(dbg);
 
-    uint8_t msg_type = buf[IDX_TYPE];
-    uint8_t xor_key  = buf[IDX_XOR];
+  // Save XOR for 3C reply
+  ctx.xor3C = m.key;
 
-    uint8_t  t0 = buf[IDX_TRK0], t1 = buf[IDX_TRK1];
-    uint16_t trackerBE = ((uint32_t)t0 << 8) | (uint32_t)t1;
+  // Reply to heartbeat only
+  const EcoflowConfig &config = *ctx.config;
+  if (config.canTxEnabled && EF_TX_ON(config, 3C)) {
+    txQueueReply(ctx, TX_REPLY_3C, m.key, m.tracker, m.finishedUs);
+  }
 
-    // CRC16 at end (hi before lo)
-    uint8_t  crc_hi = buf[targetTotal - 2];
-    uint8_t  crc_lo = buf[targetTotal - 1];
-    uint16_t crc    = ((uint16_t)crc_hi << 8) | crc_lo;
+  // Begin sequencer
+  canSequencer_onHeartbeatC4(ctx);
+}
 
-    static uint8_t decoded[MSG14001_MAX_PAYLOAD];
-    for (uint16_t i = 0; i < payloadLen; ++i)
-      decoded[i] = buf[MSG14001_HDR_LEN + i] ^ xor_key;
+// DE 0x0105 → 8C, DE 0x0141 → 24
+static void rxOnDE(BridgeContext &ctx, const RxMessage &m, void *) {
+  char dbg[128];
+  snprintf(dbg, sizeof(dbg),
+           "14001 OK type=DE len=%u cnt=%u XOR=0x%02X CRC=%04X tracker=%04X",
+           m.payloadLen, (unsigned)m.typeCount, m.key, m.crc, m.tracker);
+  streamDebug(dbg);
+
+  const EcoflowConfig &config = *ctx.config;
+  if (m.tracker == 0x0105) {
+    ctx.xor8C = m.key;
+    if (config.canTxEnabled && EF_TX_ON(config, 8C)) txQueueReply(ctx, TX_REPLY_8C, m.key, m.tracker, m.finishedUs);
+  } else {
+    ctx.xor24 = m.key;
+    if (config.canTxEnabled && EF_TX_ON(config, 24)) txQueueReply(ctx, TX_REPLY_24, m.key, m.tracker, m.finishedUs);
+  }
+}
 
-    typeCount[msg_type]++; lastType = msg_type; lastTrackerBE = trackerBE;
+// CB 0x2031 / 0x2033: BMS upper / lower charge limit, acknowledged with CB
+static void rxOnCB(BridgeContext &ctx, const RxMessage &m, void *) {
+  const schema::View<rxCB::M> v{m.payload, m.payloadLen};
+  const bool upper = (m.tracker == 0x2031);
+  const uint8_t limit = v.ok() ? (uint8_t)v.get<rxCB::Limit>() : 0;
+
+  char dbg[128];
+  snprintf(dbg, sizeof(dbg),
+           "14001 OK type=CB len=%u cnt=%u XOR=0x%02X CRC=%04X BE=0x%04X %s Limit=%u",
+           m.payloadLen, (unsigned)m.typeCount, m.key, m.crc, m.tracker,
+           upper ? "Upper" : "Lower", limit);
+  streamDebug(dbg);
+
+  EcoflowConfig &config = *ctx.config;
+  ctx.xorCB = m.key;
+  if (v.ok()) (upper ? config.bmsChgUp : config.bmsChgDn) = limit;
+
+  if (config.canTxEnabled && EF_TX_ON(config, CB)) {
+    txQueueReply(ctx, upper ? TX_REPLY_CB2031 : TX_REPLY_CB2033, m.key, m.tracker, m.finishedUs);
+  }
+}
 
-    if (msg_type == 0xC4) {
-      // Serial is expected at [3..18] for C4
-      char serial[17] = {0};
-      bool printable = (payloadLen >= 19);
-      for (int i = 0; i < 16 && i + 3 < payloadLen; ++i) {
-        uint8_t c = decoded[3 + i];
-        serial[i] = is_printable(c) ? (char)c : '?';
-        if (!is_printable(c)) printable = false;
-      }
+// Runs during static initialisation; the handler table is plain zeroed data
+static bool rxRegisterBuiltins() {
+  return rxHandlerRegister(0xC4, RX_TRACKER_ANY, rxOnC4) &&
+         rxHandlerRegister(0xDE, 0x0105, rxOnDE) &&
+         rxHandlerRegister(0xDE, 0x0141, rxOnDE) &&
+         rxHandlerRegister(0xCB, 0x2031, rxOnCB) &&
+         rxHandlerRegister(0xCB, 0x2033, rxOnCB);
+}
+static const bool kRxBuiltins = rxRegisterBuiltins();
 
-      if (printable) {
-        strncpy(SerialPS, serial, sizeof(SerialPS) - 1);
-        SerialPS[sizeof(SerialPS) - 1] = '\0';
-      } else {
-        SerialPS[0] = '\0'; // invalid / missing → clear
-      }
+void processEcoFlowCAN(BridgeContext &ctx, const ef_twai_message_t &rx) {
+  uint32_t id = rx.identifier;
+  uint32_t fullID = id & 0x1FFFFFFF;
+  const EcoflowConfig &config = *ctx.config;
+
+  auto try_finish = [&](const Msg14001 &m){
+    RxMessage msg;
+    msg.finishedUs = EF_MICROS();   // request fully reassembled
+    msg.header     = m.buf;
+    msg.payload    = m.buf + MSG14001_HDR_LEN;   // decoded in place by the reassembler
+    msg.payloadLen = m.payloadLen;
+    msg.type       = m.buf[IDX_TYPE];
+    msg.key        = m.buf[IDX_XOR];
+    msg.tracker    = ((uint16_t)m.buf[IDX_TRK0] << 8) | m.buf[IDX_TRK1];
+    msg.crc        = m.crc;
+
+    ctx.metrics.inc(MET_RX_MESSAGES);
+    msg.typeCount = ctx.metrics.incRxType(msg.type);
+    ctx.rxLastType = msg.type; ctx.rxLastTrackerBE = msg.tracker;
+
+    if (!rxDispatch(ctx, msg)) ctx.metrics.inc(MET_RX_UNHANDLED);
+  };
 
-      char dbg[256];
-      snprintf(dbg, sizeof(dbg),
-               "14001 OK type=C4 len=%u cnt=%u XOR=0x%02X CRC=%04X tracker=%02X%02X (BE=0x%04XX) serial=%s%s",
-               payloadLen, (unsigned)typeCount[msg_type], xor_key, crc,
-               t0, t1, (uint16_t)trackerBE,
-               serial, printable ? "" : " (non-printable/missing)");
-      streamDebug(dbg);
+  // ----- route incoming frame -----
+  ctx.metrics.inc(MET_RX_FRAMES);
+  if (fullID == MSG14001_START_ID) streamDebug("14001 start");
+  if (const Msg14001 *m = ctx.rx14001.feed(id, rx.data, rx.data_length_code, EF_MILLIS()))
+    try_finish(*m);
 
-      // Save XOR for 3C reply
-      xor3C = xor_key;
+  // optional raw logging (binary; formatted later by canLogFlush)
+  if (config.rxlogging) canLog.push(CAN_LOG_RX, ctx.index, EF_MILLIS(), id, rx.data, rx.data_length_code);
+}
 
-      // Reply to heartbeat only
-      if (config.canTxEnabled && config.message3C) {
-        ecoflowSend3C();
-      }
+// ================= RX queue =================
+// The canbus callback only enqueues; loop() drains and runs the protocol.
+
+// Continuation frames are charged to the most recent start
+void canRxRecordLoad(BridgeContext &ctx, const ef_twai_message_t &rx) {
+  const uint32_t fullID = rx.identifier & 0x1FFFFFFF;
+  if (fullID == MSG14001_START_ID)
+    ctx.rxBusType = (rx.data_length_code > IDX_TYPE) ? rx.data[IDX_TYPE] : BUS_LOAD_TYPE_OTHER;
+  const bool is14001 = fullID == MSG14001_START_ID || fullID == MSG14001_MID_ID || fullID == MSG14001_END_ID;
+  ctx.busLoad.record(BUS_RX, is14001 ? ctx.rxBusType : BUS_LOAD_TYPE_OTHER, rx.identifier, rx.extd,
+                     rx.data, rx.data_length_code, EF_MILLIS());
+}
 
-      // Begin sequencer
-      canSequencer_onHeartbeatC4();
-
-    } else if (msg_type == 0xDE) {
-      char dbg[128];
-      snprintf(dbg, sizeof(dbg),
-               "14001 OK type=DE len=%u cnt=%u XOR=0x%02X CRC=%04X tracker=%02X%02X (BE=0x%04X)",
-               payloadLen, (unsigned)typeCount[msg_type], xor_key, crc,
-               t0, t1, (uint16_t)trackerBE);
-      streamDebug(dbg);
-
-      if (trackerBE == 0x0105) {
-        xor8C = xor_key;
-        if (config.canTxEnabled && config.message8C) {
-          ecoflowSend8C();
-        }
-      }
-      if (trackerBE == 0x0141) {
-        xor24 = xor_key;
-        if (config.canTxEnabled && config.message24) {
-          ecoflowSend24();
-        }
-      }
+bool canRxEnqueue(BridgeContext &ctx, const ef_twai_message_t &rx) {
+  // Costed on arrival, so bus load follows the wire even when the queue is
+  // full or the loop drains late
+  canRxRecordLoad(ctx, rx);
+  if (ctx.rxQueue.push(rx)) return true;
+  ctx.metrics.inc(MET_RX_QUEUE_DROPS);
+  return false;
+}
 
-    } else if (msg_type == 0xCB) {
+uint16_t canRxDrain(BridgeContext &ctx, uint16_t maxFrames) {
+  ef_twai_message_t rx;
+  uint16_t n = 0;
+  while (n < maxFrames && ctx.rxQueue.pop(rx)) {
+    processEcoFlowCAN(ctx, rx);
+    n++;
+  }
+  // loop() is the writer of config and watts (a CB write just changed the
+  // limits the 3C reply carries): hand them to the TX side here
+  bridgePublishInputs(ctx);
+  if (n) txPumpReplies(ctx);
+  return n;
+}
 
-      if (trackerBE == 0x2031) {
-        char dbg[128];
-        snprintf(dbg, sizeof(dbg),
-                 "14001 OK type=CB len=%u cnt=%u XOR=0x%02X CRC=%04X BE=0x%04X Upper Limit=%u",
-                 payloadLen, (unsigned)typeCount[msg_type], xor_key, crc,
-                 (uint16_t)trackerBE, (payloadLen ? decoded[0] : 0));
-        streamDebug(dbg);
+// ================= Default-bridge API =================
+// The original single-PowerStream entry points, kept for existing callers.
 
-        xorCB = xor_key;
-        if (payloadLen >= 1) config.bmsChgUp = decoded[0];
+void sendCANMessage(const uint8_t *header, const uint8_t *payload, size_t headerSize, size_t payloadSize) {
+  sendCANMessage(defaultBridge(), header, payload, headerSize, payloadSize);
+}
 
-        if (config.canTxEnabled && config.messageCB) {
-          ecoflowSendCB2031();
-        }
-      }
+void processEcoFlowCAN(const ef_twai_message_t &rx) {
+  BridgeContext &ctx = defaultBridge();
+  canRxRecordLoad(ctx, rx);
+  processEcoFlowCAN(ctx, rx);
+  canHealth = ctx.canHealth;
+}
 
-      if (trackerBE == 0x2033) {
-        char dbg[128];
-        snprintf(dbg, sizeof(dbg),
-                 "14001 OK type=CB len=%u cnt=%u XOR=0x%02X CRC=%04X BE=0x%04X Lower Limit=%u",
-                 payloadLen, (unsigned)typeCount[msg_type], xor_key, crc,
-                 (uint16_t)trackerBE, (payloadLen ? decoded[0] : 0));
-        streamDebug(dbg);
+bool canRxEnqueue(const ef_twai_message_t &rx) {
+  return canRxEnqueue(defaultBridge(), rx);
+}
 
-        xorCB = xor_key;
-        if (payloadLen >= 1) config.bmsChgDn = decoded[0];
+uint16_t canRxDrain(uint16_t maxFrames) {
+  BridgeContext &ctx = defaultBridge();
+  const uint16_t n = canRxDrain(ctx, maxFrames);
+  canHealth = ctx.canHealth;
+  return n;
+}
 
-        if (config.canTxEnabled && config.messageCB) {
-          ecoflowSendCB2033();
-        }
-      }
+void canRxTick() {
+  canRxTick(defaultBridge());
+}
 
-    } else {
-      char preview[3*8+1] = {0};
-      int p = 0;
-      int show = (payloadLen < 8) ? payloadLen : 8;
-      for (int i = 0; i < show; ++i)
-        p += snprintf(preview + p, sizeof(preview) - p, "%02X", decoded[i]);
-
-      char dbg[256];
-      snprintf(dbg, sizeof(dbg),
-               "14001 OK type=0x%02X len=%u cnt=%u XOR=0x%02X CRC=%04X tracker=%02X%02X (BE=0x%04X) payload[0..%d]=%s",
-               msg_type, payloadLen, (unsigned)typeCount[msg_type], xor_key, crc,
-               t0, t1, (uint16_t)trackerBE, show-1, preview);
-      streamDebug(dbg);
-    }
+uint32_t canTxSequencerTick() {
+  BridgeContext &ctx = defaultBridge();
+  const uint32_t wait = canTxSequencerTick(ctx);
+  canHealth = ctx.canHealth;
+  return wait;
+}
 
-    reset_state();
-    return true;
-  };
+void canSequencer_onHeartbeatC4() {
+  canSequencer_onHeartbeatC4(defaultBridge());
+}
 
-  // ----- route incoming frame -----
-  if (fullID == MSG14001_START_ID) {
-    reset_state(); active = true; lastTime = EF_MILLIS();
-    append_bytes(rx.data, rx.data_length_code);
-    streamDebug("14001 start");
-  } else if (fullID == MSG14001_MID_ID) {
-    append_bytes(rx.data, rx.data_length_code);
-  } else if (fullID == MSG14001_END_ID) {
-    append_bytes(rx.data, rx.data_length_code);
-    (void)try_finish();
-  }
+void txQueueReply(TxReply kind, uint8_t key, uint16_t tracker, uint32_t requestUs) {
+  txQueueReply(defaultBridge(), kind, key, tracker, requestUs);
+}
 
-  // ----- timeout -----
-  if (active && (EF_MILLIS() - lastTime > MSG14001_TIMEOUT_MS)) {
-    streamDebug("14001 timeout — reset");
-    reset_state();
-  }
+void txPumpReplies() {
+  txPumpReplies(defaultBridge());
+}
 
-  // optional raw logging
-  if (config.rxlogging) {
-    char logBuffer[96];
-    double ts = now_seconds();
-    int len = snprintf(logBuffer, sizeof(logBuffer), "(%012.6f) vcanRx %08lX#", ts, id);
-    for (uint8_t i = 0; i < rx.data_length_code; i++)
-      len += snprintf(logBuffer + len, sizeof(logBuffer) - len, "%02X", rx.data[i]);
-    streamCanLog(logBuffer);
+const TxReplyStats &txReplyStats(TxReply kind) {
+  return txReplyStats(defaultBridge(), kind);
+}
+
+const LatencyHistogram &replyLatency(RequestType type) {
+  return replyLatency(defaultBridge(), type);
+}
+
+const Reassembler14001Stats &rx14001Stats() {
+  return rx14001Stats(defaultBridge());
+}
+
+void canBusLoad(BusLoadStats &out) {
+  canBusLoad(defaultBridge(), out);
+}
+
+const SeqStats &sequencerStats() {
+  return sequencerStats(defaultBridge());
+}
+
+// ================= CAN log consumer =================
+
+void canLogFlush(uint8_t maxRecords) {
+  static CanLogCursor cur;
+  static uint32_t reportedLost = 0;
+  CanLogRecord rec;
+  char line[80];
+
+  while (maxRecords-- && canLog.read(cur, rec)) {
+    CanLogRing::formatText(rec, line, sizeof(line));
+    streamCanLog(line);
+  }
+  if (cur.lost != reportedLost) {
+    snprintf(line, sizeof(line), "canlog: %lu records overwritten before flush",
+             (unsigned long)(cur.lost - reportedLost));
+    streamCanLog(line);
+    reportedLost = cur.lost;
   }
 }
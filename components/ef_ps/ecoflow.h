@@ -4,6 +4,11 @@
 #include <stddef.h>
 #include <string>
 #include "can.h"
+#include "crc16.h"
+#include "reassembler.h"
+#include "latency_histogram.h"
+#include "bus_load.h"
+#include "metrics.h"
 // No direct Arduino dependency — use ESPHome/standard headers only
 
 // Minimal config struct used by the messages (only fields referenced here)
@@ -45,23 +50,118 @@ struct BMS {
 };
 extern BMS bms;
 
-extern volatile uint32_t can_rx_count;
-extern volatile uint32_t can_rx_dropped;
-extern volatile uint32_t can_decoded;
+// BMS values read once per sequencer cycle; prepare functions use this
+// instead of calling the (possibly locked / UART-backed) getters per message.
+#define BMS_CELLS 16
+struct BmsSnapshot {
+  uint16_t cellMv[BMS_CELLS];
+  uint16_t minCellMv;
+  uint16_t maxCellMv;
+  uint32_t sumCellMv;
+  int      fullChargeMv;     // get_0x12_full_charge_voltage()
+  float    balanceCapacity;
+};
+
+void bmsSnapshotCapture(BMS &bms, BmsSnapshot &snap);
+
+// Frame/message/drop counters live in each bridge's metrics registry (metrics.h)
 
 extern float inputWatt;
 extern float outputWatt;
-extern std::string canLog;
 
-// (millis() is used within the implementation; use platform-appropriate helpers there)
+// Time comes from clock.h (clockNowUs(), EF_MILLIS()); harnesses may install a VirtualClock
+
+// Per-PowerStream state (bridge_context.h). The functions below act on
+// defaultBridge(), bound to the globals above and sendCANFrame(); each has a
+// BridgeContext& overload for running several bridges.
+struct BridgeContext;
+BridgeContext &defaultBridge();
 
 // Functions provided by this module
 void ecoflowMessagesInit();
-void sendCANMessage(uint8_t* header, uint8_t* payload, size_t headerSize, size_t payloadSize);
+void sendCANMessage(const uint8_t *header, const uint8_t *payload, size_t headerSize, size_t payloadSize);
 void processEcoFlowCAN(const ef_twai_message_t &rx);
-void canTxSequencerTick();
+
+// RX decoupling: the bus callback enqueues (false + MET_RX_QUEUE_DROPS when
+// full), loop() drains up to maxFrames through processEcoFlowCAN().
+#ifndef EF_RX_QUEUE_LEN
+#define EF_RX_QUEUE_LEN 128   // frames, power of two
+#endif
+bool canRxEnqueue(const ef_twai_message_t &rx);
+uint16_t canRxDrain(uint16_t maxFrames);
+// Runs the next kSeq step if due. Returns ms until the following step is
+// due, or EF_SEQ_IDLE when the sequencer is stopped (no heartbeat / TX off).
+#define EF_SEQ_IDLE 0xFFFFFFFFUL
+uint32_t canTxSequencerTick();
+const Reassembler14001Stats &rx14001Stats();
+// Bus utilisation as of now (same clock as the TX/RX hooks)
+void canBusLoad(BusLoadStats &out);
+// Advance 14001 reassembly deadlines; call from loop()
+void canRxTick();
 void canSequencer_onHeartbeatC4();
 
+// ---- Protocol replies (high-priority TX) ----
+enum TxReply : uint8_t {
+  TX_REPLY_3C,       // C4 heartbeat
+  TX_REPLY_8C,       // DE tracker 0x0105
+  TX_REPLY_24,       // DE tracker 0x0141
+  TX_REPLY_CB2031,   // CB upper limit
+  TX_REPLY_CB2033,   // CB lower limit
+  TX_REPLY_COUNT
+};
+
+// Queue→last-frame-sent latency per reply kind
+struct TxReplyStats {
+  uint32_t count;
+  uint32_t dropped;   // reply queue full
+  uint32_t lastMs;
+  uint32_t maxMs;
+  uint64_t sumMs;
+};
+
+// Request → reply latency, from the request's reassembly (try_finish) to the
+// reply's last frame being sent
+enum RequestType : uint8_t { RR_C4, RR_DE, RR_CB, RR_COUNT };
+
+// key/tracker: the request's; requestUs: EF_MICROS() when it finished reassembling
+void txQueueReply(TxReply kind, uint8_t key, uint16_t tracker, uint32_t requestUs);
+// Send all queued replies now (called before each sequencer step and after RX)
+void txPumpReplies();
+const TxReplyStats &txReplyStats(TxReply kind);
+const LatencyHistogram &replyLatency(RequestType type);
+
+// ---- Sequencer timing statistics ----
+#define EF_SEQ_MAX_STEPS    32
+// Lateness histogram buckets (ms): 0, 1, 2-3, 4-7, 8-15, 16-31, 32-63, 64+
+#define EF_SEQ_LATE_BUCKETS 8
+
+struct SeqStepStats {
+  uint32_t count;
+  uint32_t lateSumMs;
+  uint32_t lateMaxMs;
+  uint32_t hist[EF_SEQ_LATE_BUCKETS];
+};
+
+struct CycleStats {
+  uint32_t count;     // completed kSeq cycles
+  uint32_t lastMs;
+  uint32_t minMs;
+  uint32_t maxMs;
+  uint64_t sumMs;
+};
+
+struct SeqStats {
+  uint8_t  steps;            // entries used in step[]
+  uint16_t nominalCycleMs;   // sum of kSeq gaps
+  uint32_t resyncs;          // re-anchors after a stall > 1 cycle
+  CycleStats   cycle;
+  SeqStepStats step[EF_SEQ_MAX_STEPS];
+};
+
+const SeqStats &sequencerStats();
+// Format up to maxRecords pending CAN log records to streamCanLog()
+void canLogFlush(uint8_t maxRecords);
+
 // Helpers (likely implemented elsewhere in project; declared to allow linkage in tests)
 void streamDebug(const char *msg);
 void streamCanLog(const char *msg);
@@ -8,6 +8,9 @@ extern "C" {
 // ===== include your original headers =====
 #include "ecoflow.h"
 #include "can.h"
+#include "tx_task.h"
+#include "bridge_context.h"
+#include "clock.h"
 
 namespace ef_ps {
 
@@ -18,22 +21,128 @@ void sendCANFrame(uint32_t id, const uint8_t *data, uint8_t len) {
     auto *bus = EfPsComponent::instance;
     if (!bus) return;
 
-    std::vector<uint8_t> payload(data, data + len);
-    bus->send_data(id, payload);
+    bus->send_data(id, data, len);
 }
 
-// ===== singleton pointer =====
+// ===== first instance: drives the default bridge and the global sendCANFrame() =====
 EfPsComponent *EfPsComponent::instance = nullptr;
 
+void EfPsComponent::send_frame_(void *arg, uint32_t id, const uint8_t *data, uint8_t len) {
+	static_cast<EfPsComponent *>(arg)->send_data(id, data, len);
+}
+
+void EfPsMessageTrigger::on_message(BridgeContext &ctx, const RxMessage &msg, void *arg) {
+	auto *t = static_cast<EfPsMessageTrigger *>(arg);
+	if (&ctx != t->bridge) return;
+	t->trigger(std::vector<uint8_t>(msg.payload, msg.payload + msg.payloadLen), msg.tracker);
+}
+
+// Runs from loop() via canRxDrain(); payload is the reassembler slot, read in place
+void EfPsComponent::on_telemetry_(BridgeContext &ctx, const RxMessage &msg, void *arg) {
+	const auto *k = static_cast<const TelemetryKey *>(arg);
+	EfPsComponent *self = k->parent;
+	if (&ctx != self->bridge_) return;
+
+	for (auto &ts : self->telemetry_) {
+		if (ts.type != k->type || ts.tracker != k->tracker) continue;
+		int64_t v;
+		if (!rxReadField(msg, ts.field, &v)) continue;
+		if (ts.has_value && v == ts.last) continue;
+		ts.has_value = true;
+		ts.last = v;
+		ts.sensor->publish_state((float)v);
+	}
+}
+
+void EfPsComponent::set_serial(const char *serial) {
+	// 16 characters, not null-terminated when full
+	memset(this->config_.serialStr, 0, sizeof(this->config_.serialStr));
+	memcpy(this->config_.serialStr, serial, strnlen(serial, sizeof(this->config_.serialStr)));
+	this->config_set_ |= CFG_SERIAL;
+}
+
+void EfPsComponent::set_enabled_messages(uint16_t mask) {
+	EcoflowConfig &c = this->config_;
+	c.message70 = mask & TXM_70;
+	c.message0B = mask & TXM_0B;
+	c.message4F = mask & TXM_4F;
+	c.message68 = mask & TXM_68;
+	c.message13 = mask & TXM_13;
+	c.messageCB = mask & TXM_CB;
+	c.message5C = mask & TXM_5C;
+	c.message24 = mask & TXM_24;
+	c.message8C = mask & TXM_8C;
+	c.message3C = mask & TXM_3C;
+	this->config_set_ |= CFG_MESSAGES;
+}
+
+void EfPsComponent::set_input_watt(float w) {
+	if (this == instance) ::inputWatt = w;
+	else this->input_watt_ = w;
+}
+
+void EfPsComponent::set_output_watt(float w) {
+	if (this == instance) ::outputWatt = w;
+	else this->output_watt_ = w;
+}
+
+// Copy the options given in YAML into the default bridge's global config
+void EfPsComponent::apply_config_(EcoflowConfig &dst) const {
+	const EcoflowConfig &c = this->config_;
+	const uint16_t set = this->config_set_;
+	if (set & CFG_CAN_TX) dst.canTxEnabled = c.canTxEnabled;
+	if (set & CFG_SERIAL) memcpy(dst.serialStr, c.serialStr, sizeof(dst.serialStr));
+	if (set & CFG_VOLT) dst.volt = c.volt;
+	if (set & CFG_SOC) dst.soc = c.soc;
+	if (set & CFG_TEMP) dst.temp = c.temp;
+	if (set & CFG_CHGVOLT) dst.chgvolt = c.chgvolt;
+	if (set & CFG_MESSAGES) {
+		dst.message70 = c.message70; dst.message0B = c.message0B; dst.message4F = c.message4F;
+		dst.message68 = c.message68; dst.message13 = c.message13; dst.messageCB = c.messageCB;
+		dst.message5C = c.message5C; dst.message24 = c.message24; dst.message8C = c.message8C;
+		dst.message3C = c.message3C;
+	}
+	if (set & CFG_TXLOG) dst.txlogging = c.txlogging;
+	if (set & CFG_RXLOG) dst.rxlogging = c.rxlogging;
+}
+
 void EfPsComponent::setup() {
 	ESP_LOGI(TAG, "Setting up EcoFlow PS CAN LFP Bridge");
+	this->tx_buf_.reserve(8);
+
+	if (!instance) {
+		instance = this;
+		this->bridge_ = &defaultBridge();
+		this->apply_config_(::config);
+		bridgePublishInputs(*this->bridge_);
+		ecoflowMessagesInit();
+	} else {
+		// One-off allocation at setup; the context must not move afterwards
+		this->bridge_ = new BridgeContext();
+		bridgeInit(*this->bridge_, &this->config_, &bms, &this->input_watt_, &this->output_watt_,
+			&EfPsComponent::send_frame_, this);
+	}
+	this->bridge_->busLoad.setBitrate(this->bus_bit_rate_);
 
-	instance = this;
+	for (auto &mt : this->message_triggers_) {
+		mt.trigger->bridge = this->bridge_;
+		if (!rxHandlerRegister(mt.type, mt.tracker, &EfPsMessageTrigger::on_message, mt.trigger))
+			ESP_LOGW(TAG, "on_message 0x%02X: RX handler table full", mt.type);
+	}
 
-	ecoflowMessagesInit();
+	// Keys are complete before any is registered: handlers keep pointers into the vector
+	for (auto &ts : this->telemetry_) {
+		bool seen = false;
+		for (auto &k : this->telemetry_keys_) seen |= (k.type == ts.type && k.tracker == ts.tracker);
+		if (!seen) this->telemetry_keys_.push_back({this, ts.type, ts.tracker});
+	}
+	for (auto &k : this->telemetry_keys_) {
+		if (!rxHandlerRegister(k.type, k.tracker, &EfPsComponent::on_telemetry_, &k))
+			ESP_LOGW(TAG, "telemetry 0x%02X: RX handler table full", k.type);
+	}
 
 	this->canbus_->add_callback(
-		[](uint32_t can_id, bool extended_id, bool rtr, const std::vector<uint8_t> &data) {
+		[this](uint32_t can_id, bool extended_id, bool rtr, const std::vector<uint8_t> &data) {
 			(void)rtr;
 			ef_twai_message_t rx{};
 			rx.identifier = can_id;
@@ -41,26 +150,186 @@ void EfPsComponent::setup() {
 			rx.data_length_code = (uint8_t)std::min<size_t>(data.size(), 8);
 			memcpy(rx.data, data.data(), rx.data_length_code);
 
-			processEcoFlowCAN(rx);
+			canRxEnqueue(*this->bridge_, rx);
 		}
 	);
+
+#ifdef EF_PS_TX_TASK
+	if (!txTaskStart()) {
+		ESP_LOGW(TAG, "TX task could not be started, sequencer falls back to loop()");
+	}
+#endif
 }
 
 void EfPsComponent::loop() {
-	canTxSequencerTick();
+	BridgeContext &ctx = *this->bridge_;
+	canRxDrain(ctx, EF_RX_QUEUE_LEN);
+	canRxTick(ctx);
+	if (!txTaskRunning()) canTxSequencerTick(ctx);
+	if (this == instance) {
+		canHealth = ctx.canHealth;
+#if ESPHOME_LOG_LEVEL >= ESPHOME_LOG_LEVEL_DEBUG
+		// the log lines go out at debug level; below it formatting them is wasted.
+		// One ring for all bridges, its records tagged with the bridge index
+		canLogFlush(16);
+#endif
+	}
 }
 
 void EfPsComponent::update() {
-    canTxSequencerTick();
+    if (!txTaskRunning()) canTxSequencerTick(*this->bridge_);
+    this->publish_reply_latency_();
+    this->publish_bus_load_();
+    this->publish_sequencer_();
+    this->publish_metrics_();
 }
 
-void EfPsComponent::send_data(uint32_t id, const std::vector<uint8_t> &payload) {
+void EfPsComponent::publish_metrics_() {
+	const MetricsRegistry &metrics = this->bridge_->metrics;
+	const uint32_t now = clockMillis();
+	const uint32_t dt = now - this->metric_prev_ms_;
+	const bool have_prev = this->metric_prev_ms_ != 0 && dt > 0;
+	for (uint8_t i = 0; i < MET_COUNT; i++) {
+		const uint32_t v = metrics.get((MetricId)i);
+		auto *total = this->metric_[i];
+		if (total && (!total->has_state() || total->state != (float)v)) total->publish_state(v);
+		auto *rate = this->metric_rate_[i];
+		if (rate && have_prev) rate->publish_state((v - this->metric_prev_[i]) * 1000.0f / dt);
+		this->metric_prev_[i] = v;
+	}
+	this->metric_prev_ms_ = now;
+
+	for (auto &ts : this->rx_type_sensors_) {
+		const uint32_t v = metrics.rxType(ts.first);
+		if (!ts.second->has_state() || ts.second->state != (float)v) ts.second->publish_state(v);
+	}
+}
+
+void EfPsComponent::publish_bus_load_() {
+	if (!this->bus_load_ && !this->bus_load_peak_) return;
+	BusLoadStats st;
+	canBusLoad(*this->bridge_, st);
+	if (this->bus_load_) this->bus_load_->publish_state(st.loadPct);
+	if (this->bus_load_peak_) this->bus_load_peak_->publish_state(st.peak100Pct);
+}
+
+void EfPsComponent::publish_sequencer_() {
+	const SeqStats &st = sequencerStats(*this->bridge_);
+	if (this->seq_cycle_ && st.cycle.count) {
+		const float ms = st.cycle.lastMs;
+		if (!this->seq_cycle_->has_state() || this->seq_cycle_->state != ms) this->seq_cycle_->publish_state(ms);
+	}
+	if (this->seq_late_max_) {
+		uint32_t late = 0;
+		for (uint8_t i = 0; i < st.steps; i++)
+			if (st.step[i].lateMaxMs > late) late = st.step[i].lateMaxMs;
+		if (!this->seq_late_max_->has_state() || this->seq_late_max_->state != (float)late)
+			this->seq_late_max_->publish_state(late);
+	}
+	if (this->seq_resyncs_ && (!this->seq_resyncs_->has_state() || this->seq_resyncs_->state != (float)st.resyncs))
+		this->seq_resyncs_->publish_state(st.resyncs);
+}
+
+void EfPsComponent::publish_reply_latency_() {
+	static const uint8_t kPct[2] = {50, 99};
+	for (uint8_t t = 0; t < RR_COUNT; t++) {
+		const LatencyHistogram &h = replyLatency(*this->bridge_, (RequestType)t);
+		if (!h.count) continue;
+		for (uint8_t p = 0; p < 2; p++) {
+			auto *s = this->reply_latency_[t][p];
+			if (!s) continue;
+			const float ms = h.percentileUs(kPct[p]) / 1000.0f;
+			if (!s->has_state() || s->state != ms) s->publish_state(ms);
+		}
+	}
+}
+
+void EfPsComponent::send_data(uint32_t id, const uint8_t *data, uint8_t len) {
 	if (!this->canbus_) return;
-	this->canbus_->send_data(id, /*use_extended_id=*/true, payload);
+	// Canbus::send_data() takes a vector; reusing one reserved in setup()
+	// keeps the per-frame path free of heap allocations
+	if (len > 8) len = 8;
+	this->tx_buf_.assign(data, data + len);
+	if (this->canbus_->send_data(id, true, false, this->tx_buf_) != esphome::canbus::ERROR_OK && this->bridge_)
+		this->bridge_->metrics.inc(MET_TX_ERRORS);
 }
 
 void EfPsComponent::dump_config() {
 	ESP_LOGCONFIG(TAG, "EcoFlow PS CAN LFP Bridge");
+
+	ESP_LOGCONFIG(TAG, "  TX timing: %s", txTaskRunning() ? "dedicated task" : "loop()");
+	const EcoflowConfig &c = *this->bridge_->config;
+	ESP_LOGCONFIG(TAG, "  Bridge %u: TX %s, serial %.16s, %d.%02d V, SOC %d%%, %d C",
+		this->bridge_->index, c.canTxEnabled ? "on" : "off", c.serialStr[0] ? c.serialStr : "-",
+		c.volt / 100, c.volt % 100, c.soc, c.temp);
+	for (auto &ts : this->telemetry_)
+		ESP_LOGCONFIG(TAG, "  Telemetry 0x%02X/%s%04X +%u (%u bytes%s%s)", ts.type,
+			ts.tracker == RX_TRACKER_ANY ? "*" : "", (unsigned)(ts.tracker & 0xFFFF), ts.field.offset,
+			ts.field.width, ts.field.bigEndian ? ", BE" : "", ts.field.isSigned ? ", signed" : "");
+
+	const MetricsRegistry &metrics = this->bridge_->metrics;
+	for (uint8_t i = 0; i < MET_COUNT; i++)
+		ESP_LOGCONFIG(TAG, "  %s: %u", MetricsRegistry::name((MetricId)i), (unsigned)metrics.get((MetricId)i));
+	for (unsigned t = 0; t < 256; t++) {
+		const uint32_t n = metrics.rxType((uint8_t)t);
+		if (n) ESP_LOGCONFIG(TAG, "  rx type 0x%02X: %u", t, (unsigned)n);
+	}
+
+	static const char *const kReplyNames[TX_REPLY_COUNT] = {"3C", "8C", "24", "CB2031", "CB2033"};
+	for (uint8_t i = 0; i < TX_REPLY_COUNT; i++) {
+		const TxReplyStats &r = txReplyStats(*this->bridge_, (TxReply)i);
+		if (!r.count && !r.dropped) continue;
+		ESP_LOGCONFIG(TAG, "  Reply %s: %u sent, %u dropped, latency last %u ms, max %u ms, mean %u ms",
+			kReplyNames[i], (unsigned)r.count, (unsigned)r.dropped, (unsigned)r.lastMs, (unsigned)r.maxMs,
+			r.count ? (unsigned)(r.sumMs / r.count) : 0u);
+	}
+
+	static const char *const kRequestNames[RR_COUNT] = {"C4->3C", "DE->8C/24", "CB->CB"};
+	for (uint8_t t = 0; t < RR_COUNT; t++) {
+		const LatencyHistogram &h = replyLatency(*this->bridge_, (RequestType)t);
+		if (!h.count) continue;
+		ESP_LOGCONFIG(TAG, "  %s latency: p50 %u us, p90 %u us, p99 %u us, max %u us (%u replies)",
+			kRequestNames[t], (unsigned)h.percentileUs(50), (unsigned)h.percentileUs(90),
+			(unsigned)h.percentileUs(99), (unsigned)h.maxUs, (unsigned)h.count);
+	}
+
+	BusLoadStats bl;
+	canBusLoad(*this->bridge_, bl);
+	ESP_LOGCONFIG(TAG, "  Bus load @ %u kbit/s: %.1f%% (1 s), peak 100 ms %.1f%%, max peak %.1f%%",
+		(unsigned)(bl.bitrate / 1000), bl.loadPct, bl.peak100Pct, bl.maxPeak100Pct);
+	if (bl.bitrate != 500000) {
+		// what the same traffic would cost on a 500 kbit/s bus
+		const float k = (float)bl.bitrate / 500000.0f;
+		ESP_LOGCONFIG(TAG, "    at 500 kbit/s: %.1f%%, peak 100 ms %.1f%%", bl.loadPct * k, bl.peak100Pct * k);
+	}
+	const uint64_t allBits = bl.bits[BUS_RX] + bl.bits[BUS_TX];
+	BusLoadType types[BUS_LOAD_TYPES];
+	const size_t nTypes = this->bridge_->busLoad.types(types, BUS_LOAD_TYPES);
+	for (size_t i = 0; i < nTypes && allBits; i++) {
+		const BusLoadType &t = types[i];
+		char name[8];
+		if (t.type == BUS_LOAD_TYPE_OTHER) snprintf(name, sizeof(name), "other");
+		else snprintf(name, sizeof(name), "0x%02X", (unsigned)t.type);
+		ESP_LOGCONFIG(TAG, "    %s %-5s %5.1f%% of bits, %u frames",
+			t.dir == BUS_TX ? "TX" : "RX", name, (double)t.bits * 100.0 / (double)allBits, (unsigned)t.frames);
+	}
+
+	const SeqStats &seq = sequencerStats(*this->bridge_);
+	ESP_LOGCONFIG(TAG, "  Sequencer: %u steps, nominal cycle %u ms, resyncs %u",
+		seq.steps, seq.nominalCycleMs, (unsigned)seq.resyncs);
+	if (seq.cycle.count) {
+		ESP_LOGCONFIG(TAG, "  Cycle period: last %u ms, min %u ms, max %u ms, mean %u ms (%u cycles)",
+			(unsigned)seq.cycle.lastMs, (unsigned)seq.cycle.minMs, (unsigned)seq.cycle.maxMs,
+			(unsigned)(seq.cycle.sumMs / seq.cycle.count), (unsigned)seq.cycle.count);
+	}
+	for (uint8_t i = 0; i < seq.steps; i++) {
+		const SeqStepStats &st = seq.step[i];
+		if (!st.count) continue;
+		ESP_LOGCONFIG(TAG, "  Step %2u late: mean %u ms, max %u ms, hist %u/%u/%u/%u/%u/%u/%u/%u",
+			i, (unsigned)(st.lateSumMs / st.count), (unsigned)st.lateMaxMs,
+			(unsigned)st.hist[0], (unsigned)st.hist[1], (unsigned)st.hist[2], (unsigned)st.hist[3],
+			(unsigned)st.hist[4], (unsigned)st.hist[5], (unsigned)st.hist[6], (unsigned)st.hist[7]);
+	}
 }
 
 }  // namespace ef_ps
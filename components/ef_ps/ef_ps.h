@@ -1,11 +1,25 @@
 #pragma once
 
+#include "esphome/core/automation.h"
 #include "esphome/core/component.h"
 #include "esphome/components/canbus/canbus.h"
+#include "esphome/components/sensor/sensor.h"
+#include "ecoflow.h"
+#include "bridge_context.h"
+#include "rx_dispatch.h"
+#include <utility>
 #include <vector>
 
 namespace ef_ps {
 
+// YAML on_message: decoded payload and tracker of each matching message
+// received on the owning component's bridge
+class EfPsMessageTrigger : public esphome::Trigger<std::vector<uint8_t>, uint16_t> {
+ public:
+  static void on_message(BridgeContext &ctx, const RxMessage &msg, void *arg);
+  BridgeContext *bridge{nullptr};
+};
+
 class EfPsComponent : public esphome::PollingComponent {
  public:
   static EfPsComponent *instance;
@@ -13,16 +27,120 @@ class EfPsComponent : public esphome::PollingComponent {
     this->canbus_ = canbus;
   }
 
+  // Request→reply latency percentile (pct 50 or 99) for a RequestType
+  void set_reply_latency_sensor(uint8_t type, uint8_t pct, esphome::sensor::Sensor *s) {
+    if (type < RR_COUNT) this->reply_latency_[type][pct >= 99 ? 1 : 0] = s;
+  }
+
+  // Initial config from YAML. Only the options given are applied: the first
+  // ef_ps writes them into the global config at setup(), leaving the other
+  // fields to lambdas; further instances start from a zeroed config_.
+  void set_can_tx_enabled(bool v) { this->config_.canTxEnabled = v; this->config_set_ |= CFG_CAN_TX; }
+  void set_serial(const char *serial);
+  void set_voltage(int v) { this->config_.volt = v; this->config_set_ |= CFG_VOLT; }
+  void set_soc(int v) { this->config_.soc = v; this->config_set_ |= CFG_SOC; }
+  void set_temperature(int v) { this->config_.temp = v; this->config_set_ |= CFG_TEMP; }
+  void set_charge_voltage(int v) { this->config_.chgvolt = v; this->config_set_ |= CFG_CHGVOLT; }
+  // config.messageXX flags from a TXM_* mask (tx_schedule.h)
+  void set_enabled_messages(uint16_t mask);
+  void set_tx_logging(bool v) { this->config_.txlogging = v; this->config_set_ |= CFG_TXLOG; }
+  void set_rx_logging(bool v) { this->config_.rxlogging = v; this->config_set_ |= CFG_RXLOG; }
+  // Inverter-side watts of this bridge, e.g. from a sensor lambda
+  void set_input_watt(float w);
+  void set_output_watt(float w);
+
+  void set_bus_bit_rate(uint32_t bps) { this->bus_bit_rate_ = bps; }
+  void set_bus_load_sensor(esphome::sensor::Sensor *s) { this->bus_load_ = s; }
+  void set_bus_load_peak_sensor(esphome::sensor::Sensor *s) { this->bus_load_peak_ = s; }
+
+  // kSeq timing from sequencerStats(): last cycle, worst step lateness, resyncs
+  void set_seq_cycle_sensor(esphome::sensor::Sensor *s) { this->seq_cycle_ = s; }
+  void set_seq_late_max_sensor(esphome::sensor::Sensor *s) { this->seq_late_max_ = s; }
+  void set_seq_resyncs_sensor(esphome::sensor::Sensor *s) { this->seq_resyncs_ = s; }
+
+  // Counter total / per-second rate for a MetricId
+  void set_metric_sensor(uint8_t id, esphome::sensor::Sensor *s) {
+    if (id < MET_COUNT) this->metric_[id] = s;
+  }
+  void set_metric_rate_sensor(uint8_t id, esphome::sensor::Sensor *s) {
+    if (id < MET_COUNT) this->metric_rate_[id] = s;
+  }
+  // Reassembled RX messages of one header msg_type
+  void add_rx_type_sensor(uint8_t type, esphome::sensor::Sensor *s) {
+    this->rx_type_sensors_.push_back({type, s});
+  }
+  // tracker: 0..0xFFFF or RX_TRACKER_ANY; registered with rx_dispatch in setup()
+  void add_on_message_trigger(uint8_t type, uint32_t tracker, EfPsMessageTrigger *t) {
+    this->message_triggers_.push_back({type, tracker, t});
+  }
+  // Payload field of (type, tracker) read in place; published when it changes
+  void add_telemetry_sensor(uint8_t type, uint32_t tracker, uint16_t offset, uint8_t width,
+                            bool big_endian, bool is_signed, esphome::sensor::Sensor *s) {
+    this->telemetry_.push_back({type, tracker, {offset, width, big_endian, is_signed}, false, 0, s});
+  }
+
   void setup() override;
   void loop() override;
   void update() override;
   void dump_config() override;
-  void send_data(uint32_t id, const std::vector<uint8_t> &payload);
+  // Extended-ID frame, len <= 8; no heap allocation
+  void send_data(uint32_t id, const uint8_t *data, uint8_t len);
+
+  // Protocol state of this PowerStream (valid after setup()). The first
+  // ef_ps uses defaultBridge(), bound to the global config/bms/inputWatt/
+  // outputWatt; further instances get their own config and watts, reached
+  // through bridge()->config and set_input_watt()/set_output_watt(). Each
+  // bridge keeps its own counters in bridge()->metrics.
+  BridgeContext *bridge() { return this->bridge_; }
 
  protected:
   esphome::canbus::Canbus *canbus_{nullptr};
+  BridgeContext *bridge_{nullptr};
+  std::vector<uint8_t> tx_buf_;   // one frame for Canbus::send_data(), reserved in setup()
+  EcoflowConfig config_{};        // YAML config; own binding when not the default bridge
+  enum : uint16_t {
+    CFG_CAN_TX = 1 << 0, CFG_SERIAL = 1 << 1, CFG_VOLT = 1 << 2, CFG_SOC = 1 << 3, CFG_TEMP = 1 << 4,
+    CFG_CHGVOLT = 1 << 5, CFG_MESSAGES = 1 << 6, CFG_TXLOG = 1 << 7, CFG_RXLOG = 1 << 8,
+  };
+  uint16_t config_set_{0};        // CFG_* options given in YAML
+  float input_watt_{0};
+  float output_watt_{0};
+  uint32_t bus_bit_rate_{EF_CAN_BITRATE};
+  esphome::sensor::Sensor *reply_latency_[RR_COUNT][2]{};
+  esphome::sensor::Sensor *bus_load_{nullptr};
+  esphome::sensor::Sensor *bus_load_peak_{nullptr};
+  esphome::sensor::Sensor *seq_cycle_{nullptr};
+  esphome::sensor::Sensor *seq_late_max_{nullptr};
+  esphome::sensor::Sensor *seq_resyncs_{nullptr};
+  esphome::sensor::Sensor *metric_[MET_COUNT]{};
+  esphome::sensor::Sensor *metric_rate_[MET_COUNT]{};
+  uint32_t metric_prev_[MET_COUNT]{};
+  uint32_t metric_prev_ms_{0};
+  std::vector<std::pair<uint8_t, esphome::sensor::Sensor *>> rx_type_sensors_;
+  struct MessageTrigger { uint8_t type; uint32_t tracker; EfPsMessageTrigger *trigger; };
+  std::vector<MessageTrigger> message_triggers_;
+  struct TelemetrySensor {
+    uint8_t type;
+    uint32_t tracker;
+    RxField field;
+    bool has_value;
+    int64_t last;
+    esphome::sensor::Sensor *sensor;
+  };
+  // One RX handler per distinct (type, tracker); owns no sensors itself
+  struct TelemetryKey { EfPsComponent *parent; uint8_t type; uint32_t tracker; };
+  std::vector<TelemetrySensor> telemetry_;
+  std::vector<TelemetryKey> telemetry_keys_;
+
+  void publish_reply_latency_();
+  void publish_bus_load_();
+  void publish_sequencer_();
+  void publish_metrics_();
+  void apply_config_(EcoflowConfig &dst) const;
 
+  static void on_telemetry_(BridgeContext &ctx, const RxMessage &msg, void *arg);
   static void on_can_frame(const esphome::canbus::CanFrame &frame);
+  static void send_frame_(void *arg, uint32_t id, const uint8_t *data, uint8_t len);
 };
 
 }  // namespace ef_ps
@@ -0,0 +1,50 @@
+#include "frame_encoder.h"
+#include "crc16.h"
+
+FrameEncoder::FrameEncoder(uint32_t id_first, uint32_t id_middle, uint32_t id_last,
+                           bool length_prefixed, EmitFn emit, void *emitArg)
+    : id_first_(id_first), id_middle_(id_middle), id_last_(id_last),
+      length_prefixed_(length_prefixed), emit_(emit), emitArg_(emitArg),
+      fill_(length_prefixed ? 1 : 0), folded_(fill_), crc_(crc16Init()), frames_(0), sealed_(false) {}
+
+void FrameEncoder::write(const uint8_t *data, size_t len) {
+  for (size_t i = 0; i < len; i++) put(data[i]);
+}
+
+void FrameEncoder::writeXor(const uint8_t *data, size_t len, uint8_t xor_key) {
+  for (size_t i = 0; i < len; i++) put((data ? data[i] : 0x00) ^ xor_key);
+}
+
+void FrameEncoder::finish() {
+  foldCrc();
+  sealed_ = true;
+  const uint16_t crc = crc16Final(crc_);
+  put((uint8_t)(crc & 0xFF));
+  put((uint8_t)(crc >> 8));
+  emitFrame(true);
+}
+
+void FrameEncoder::put(uint8_t b) {
+  // Stage is full and more data follows → it cannot be the last frame
+  if (fill_ == sizeof(stage_)) emitFrame(false);
+  stage_[fill_++] = b;
+}
+
+void FrameEncoder::foldCrc() {
+  if (sealed_ || fill_ == folded_) return;
+  crc_ = crc16Update(crc_, &stage_[folded_], fill_ - folded_);
+  folded_ = fill_;
+}
+
+void FrameEncoder::emitFrame(bool last) {
+  const uint8_t base = length_prefixed_ ? 1 : 0;
+  if (fill_ == base) return;
+  foldCrc();
+
+  if (length_prefixed_) stage_[0] = (uint8_t)(fill_ - 1);   // length of following bytes
+  uint32_t id = (frames_ == 0) ? id_first_ : (last ? id_last_ : id_middle_);
+  emit_(emitArg_, id, stage_, fill_);
+
+  frames_++;
+  fill_ = folded_ = base;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Streaming EcoFlow message → CAN frame encoder.
+//
+// Bytes are written once: payload bytes are XORed on the way in, the CRC is
+// folded over every staged frame and each 8-byte frame is handed to `emit`
+// as soon as the next byte proves it is not the last one. Only the fixed
+// 8-byte staging buffer is kept, no copy of the whole message.
+//
+// Two framings are supported:
+//   raw      — up to 8 message bytes per frame
+//   length   — [len][<=7 message bytes] per frame (msg_type 0xA0)
+class FrameEncoder {
+ public:
+  typedef void (*EmitFn)(void *arg, uint32_t id, const uint8_t *data, uint8_t len);
+
+  FrameEncoder(uint32_t id_first, uint32_t id_middle, uint32_t id_last,
+               bool length_prefixed, EmitFn emit, void *emitArg = nullptr);
+
+  // Plain bytes (header), sent as-is
+  void write(const uint8_t *data, size_t len);
+  // Payload bytes, XORed with `xor_key`; nullptr sends `len` encoded zeros
+  void writeXor(const uint8_t *data, size_t len, uint8_t xor_key);
+  // Append CRC16 (LE) over everything written and flush the last frame
+  void finish();
+
+ private:
+  void put(uint8_t b);
+  void emitFrame(bool last);
+  void foldCrc();
+
+  const uint32_t id_first_, id_middle_, id_last_;
+  const bool length_prefixed_;
+  const EmitFn emit_;
+  void *const emitArg_;
+
+  uint8_t  stage_[8];
+  uint8_t  fill_;      // bytes in stage_ (incl. length prefix)
+  uint8_t  folded_;    // stage_ bytes already folded into crc_
+  uint16_t crc_;
+  uint16_t frames_;
+  bool     sealed_;    // CRC trailer being written; stop folding
+};
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stdint.h>
+
+// Fixed-bucket log2 latency histogram in microseconds.
+// Bucket 0 holds 0-1 us, bucket i holds [2^i, 2^(i+1)) us, the last bucket
+// everything from ~8.4 s up. Percentiles resolve to a bucket's upper edge.
+#define EF_LAT_BUCKETS 24
+
+struct LatencyHistogram {
+  uint32_t bucket[EF_LAT_BUCKETS];
+  uint32_t count;
+  uint32_t maxUs;
+
+  void record(uint32_t us) {
+    uint8_t b = 0;
+    while (b + 1 < EF_LAT_BUCKETS && (us >> (b + 1)) != 0) b++;
+    bucket[b]++;
+    count++;
+    if (us > maxUs) maxUs = us;
+  }
+
+  // pct in 1..100; 0 when empty
+  uint32_t percentileUs(uint8_t pct) const {
+    if (!count) return 0;
+    const uint32_t rank = (uint32_t)(((uint64_t)count * pct + 99) / 100);
+    uint32_t seen = 0;
+    for (uint8_t b = 0; b < EF_LAT_BUCKETS; b++) {
+      seen += bucket[b];
+      if (seen >= rank) {
+        const uint32_t edge = (b + 1 < 32) ? ((1UL << (b + 1)) - 1) : 0xFFFFFFFFUL;
+        return (edge < maxUs) ? edge : maxUs;
+      }
+    }
+    return maxUs;
+  }
+};
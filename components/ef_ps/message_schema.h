@@ -0,0 +1,267 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <type_traits>
+
+// Compile-time layout of the dynamic fields in each outgoing payload, and of
+// the known fields of received ones.
+//
+// A field is a type carrying its offset, width and byte order; put()/get()
+// are fixed-size accesses the compiler folds into a single 16/32-bit
+// load/store on little-endian targets. Every field static_asserts that it
+// fits inside its message, so a wrong offset fails the build instead of
+// corrupting the neighbouring array.
+//
+// Outgoing payloads are const templates in flash. A bridge only keeps an
+// Overlay in RAM: the dynamic fields packed back to back, which the encoder
+// substitutes for their spans of the template on the way out.
+
+namespace schema {
+
+enum class Endian { Little, Big };
+
+template <size_t W, Endian E>
+inline void store(uint8_t *p, uint32_t v) {
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+  if (E == Endian::Little) {
+    if (W == 1) { *p = (uint8_t)v; return; }
+    if (W == 2) { uint16_t x = (uint16_t)v; memcpy(p, &x, 2); return; }
+    if (W == 4) { memcpy(p, &v, 4); return; }
+  }
+#endif
+  for (size_t i = 0; i < W; i++) {
+    const size_t shift = 8 * ((E == Endian::Little) ? i : (W - 1 - i));
+    p[i] = (uint8_t)(v >> shift);
+  }
+}
+
+template <size_t W, Endian E>
+inline uint32_t load(const uint8_t *p) {
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+  if (E == Endian::Little) {
+    if (W == 1) return *p;
+    if (W == 2) { uint16_t x; memcpy(&x, p, 2); return x; }
+    if (W == 4) { uint32_t x; memcpy(&x, p, 4); return x; }
+  }
+#endif
+  uint32_t v = 0;
+  for (size_t i = 0; i < W; i++) {
+    const size_t shift = 8 * ((E == Endian::Little) ? i : (W - 1 - i));
+    v |= (uint32_t)p[i] << shift;
+  }
+  return v;
+}
+
+template <size_t SIZE>
+struct Message {
+  static constexpr size_t size = SIZE;
+
+  // Scalar: 1, 2 or 4 bytes
+  template <size_t OFF, size_t W, Endian E = Endian::Little>
+  struct Field {
+    static_assert(W == 1 || W == 2 || W == 4, "field width must be 1, 2 or 4");
+    static_assert(OFF + W <= SIZE, "field does not fit in message");
+    static constexpr size_t offset = OFF;
+    static constexpr size_t width = W;
+    static constexpr size_t span = W;
+    static inline void put(uint8_t *m, uint32_t v) { store<W, E>(m + OFF, v); }
+    static inline void putAt(uint8_t *p, uint32_t v) { store<W, E>(p, v); }
+    static inline uint32_t get(const uint8_t *m) { return load<W, E>(m + OFF); }
+  };
+
+  // Opaque byte run (serial numbers, strings)
+  template <size_t OFF, size_t LEN>
+  struct Bytes {
+    static_assert(OFF + LEN <= SIZE, "byte field does not fit in message");
+    static constexpr size_t offset = OFF;
+    static constexpr size_t width = LEN;
+    static constexpr size_t span = LEN;
+    static inline void put(uint8_t *m, const void *src) { memcpy(m + OFF, src, LEN); }
+    static inline void fill(uint8_t *m, uint8_t v) { memset(m + OFF, v, LEN); }
+    static inline void putAt(uint8_t *p, const void *src) { memcpy(p, src, LEN); }
+    static inline void fillAt(uint8_t *p, uint8_t v) { memset(p, v, LEN); }
+    static inline const uint8_t *ptr(const uint8_t *m) { return m + OFF; }
+  };
+
+  // COUNT consecutive scalars of width W
+  template <size_t OFF, size_t COUNT, size_t W, Endian E = Endian::Little>
+  struct Array {
+    static_assert(W == 1 || W == 2 || W == 4, "element width must be 1, 2 or 4");
+    static_assert(OFF + COUNT * W <= SIZE, "array does not fit in message");
+    static constexpr size_t offset = OFF;
+    static constexpr size_t count = COUNT;
+    static constexpr size_t span = COUNT * W;
+    static inline void put(uint8_t *m, size_t i, uint32_t v) { store<W, E>(m + OFF + i * W, v); }
+    static inline void putAt(uint8_t *p, size_t i, uint32_t v) { store<W, E>(p + i * W, v); }
+    static inline uint32_t get(const uint8_t *m, size_t i) { return load<W, E>(m + OFF + i * W); }
+  };
+};
+
+// Template bytes [offset, offset + len) that come from an overlay instead
+struct Span {
+  uint16_t offset;
+  uint16_t len;
+};
+
+template <size_t N>
+constexpr bool spansOrdered(const Span (&s)[N], size_t size) {
+  for (size_t i = 0; i + 1 < N; i++)
+    if (s[i].offset + s[i].len > s[i + 1].offset) return false;
+  return N == 0 || s[N - 1].offset + s[N - 1].len <= size;
+}
+
+// The fields F of message M, packed in the order given. Fields must be
+// listed by ascending offset without overlap, so the encoder can merge
+// template and overlay in one forward pass.
+template <class M, class... F>
+struct Overlay {
+  static constexpr size_t size = (F::span + ... + 0);
+  static constexpr Span spans[] = {{(uint16_t)F::offset, (uint16_t)F::span}...};
+  static_assert(spansOrdered(spans, M::size), "overlay fields out of order or overlapping");
+
+  template <class X>
+  static constexpr size_t offsetOf() {
+    static_assert((std::is_same<X, F>::value || ...), "field is not part of this overlay");
+    constexpr bool match[] = {std::is_same<X, F>::value...};
+    constexpr size_t span[] = {F::span...};
+    size_t off = 0;
+    for (size_t i = 0; !match[i]; i++) off += span[i];
+    return off;
+  }
+
+  template <class X, class... A>
+  static inline void put(uint8_t *ov, A... a) {
+    constexpr size_t off = offsetOf<X>();
+    X::putAt(ov + off, a...);
+  }
+  template <class X>
+  static inline void fill(uint8_t *ov, uint8_t v) {
+    constexpr size_t off = offsetOf<X>();
+    X::fillAt(ov + off, v);
+  }
+};
+
+// Read-only window onto a received payload. Nothing is copied: the view
+// points into the reassembler slot and is valid for as long as the buffer
+// is, i.e. inside the RX handler. SIZE of a received layout is the shortest
+// payload that holds all its fields; longer payloads are fine.
+template <class M>
+struct View {
+  const uint8_t *p;
+  size_t len;
+
+  bool ok() const { return p && len >= M::size; }
+  template <class F> uint32_t get() const { return F::get(p); }
+  template <class F> uint32_t get(size_t i) const { return F::get(p, i); }
+  template <class F> const uint8_t *bytes() const { return F::ptr(p); }
+};
+
+}  // namespace schema
+
+// ================= EcoFlow payload layouts =================
+// Only the fields written by prepareMessageXX; everything else is template.
+// Overlay lists them all: it is what each bridge holds per message.
+
+namespace msg13 {
+using M = schema::Message<186>;
+using Temp         = M::Field<7, 1>;
+using Volt         = M::Field<12, 2>;
+using Temp2        = M::Field<20, 1>;
+using MaxCellMv    = M::Field<39, 2>;
+using MinCellMv    = M::Field<41, 2>;
+using CellTemps    = M::Bytes<43, 4>;
+using InputWatt    = M::Field<57, 2>;
+using OutputWatt   = M::Field<61, 2>;
+using CellMv       = M::Array<77, 16, 2>;
+using Serial       = M::Bytes<122, 16>;
+using FullChgMv    = M::Field<148, 2>;
+using Overlay      = schema::Overlay<M, Temp, Volt, Temp2, MaxCellMv, MinCellMv, CellTemps,
+                                     InputWatt, OutputWatt, CellMv, Serial, FullChgMv>;
+}  // namespace msg13
+
+namespace msg3C {
+using M = schema::Message<132>;
+using Serial       = M::Bytes<3, 16>;
+using ChgVolt      = M::Field<41, 2>;
+using Soc          = M::Field<56, 1>;
+using Volt         = M::Field<57, 2>;
+using Temps        = M::Bytes<114, 2>;
+using ChgRuntime   = M::Field<120, 4>;
+using DisRuntime   = M::Field<124, 4>;
+using BmsChgUp     = M::Field<128, 1>;
+using BmsChgDn     = M::Field<129, 1>;
+using Overlay      = schema::Overlay<M, Serial, ChgVolt, Soc, Volt, Temps, ChgRuntime,
+                                     DisRuntime, BmsChgUp, BmsChgDn>;
+}  // namespace msg3C
+
+namespace msg0B {
+using M = schema::Message<26>;
+using VoltPlus1000 = M::Field<1, 2>;
+using VoltRelease  = M::Field<9, 2>;
+using Overlay      = schema::Overlay<M, VoltPlus1000, VoltRelease>;
+}  // namespace msg0B
+
+namespace msg70 {
+using M = schema::Message<32>;
+using Serial       = M::Bytes<1, 16>;
+using Overlay      = schema::Overlay<M, Serial>;
+}  // namespace msg70
+
+namespace msg5C {
+using M = schema::Message<10>;
+using Volt         = M::Field<2, 2>;
+using Flag         = M::Field<4, 1>;
+using Overlay      = schema::Overlay<M, Volt, Flag>;
+}  // namespace msg5C
+
+namespace msg68 {
+using M = schema::Message<128>;
+using Serial       = M::Bytes<0, 16>;
+using Soc          = M::Field<37, 1>;
+using Volt         = M::Field<38, 2>;
+using Temp         = M::Field<46, 1>;
+using Charging     = M::Field<47, 1>;
+using BalanceCap   = M::Field<57, 2>;
+using MaxCellMv    = M::Field<65, 2>;
+using MinCellMv    = M::Field<69, 2>;
+using InputWatt    = M::Field<78, 2>;
+using OutputWatt   = M::Field<82, 2>;
+using DisRuntime   = M::Field<86, 4>;
+using BmsChgUp     = M::Field<91, 1>;
+using BmsChgDn     = M::Field<92, 1>;
+using Overlay      = schema::Overlay<M, Serial, Soc, Volt, Temp, Charging, BalanceCap, MaxCellMv,
+                                     MinCellMv, InputWatt, OutputWatt, DisRuntime, BmsChgUp, BmsChgDn>;
+}  // namespace msg68
+
+namespace msg4F {
+using M = schema::Message<35>;
+using Soc          = M::Field<0, 1>;
+using Charging     = M::Field<1, 1>;
+using InputWatt    = M::Field<2, 4>;
+using OutputWatt   = M::Field<6, 4>;
+using ChgRuntime   = M::Field<10, 4>;
+using BmsChgUp     = M::Field<15, 1>;
+using BmsChgDn     = M::Field<16, 1>;
+using Overlay      = schema::Overlay<M, Soc, Charging, InputWatt, OutputWatt, ChgRuntime, BmsChgUp, BmsChgDn>;
+}  // namespace msg4F
+
+namespace msg24 {
+using M = schema::Message<36>;
+using Serial       = M::Bytes<8, 16>;
+using Overlay      = schema::Overlay<M, Serial>;
+}  // namespace msg24
+
+// ================= Received payload layouts =================
+// Fields the bridge understands in 0x10x14001 payloads (after XOR decode).
+
+namespace rxC4 {
+using M = schema::Message<19>;
+using Serial       = M::Bytes<3, 16>;
+}  // namespace rxC4
+
+namespace rxCB {
+using M = schema::Message<1>;
+using Limit        = M::Field<0, 1>;   // %, tracker 0x2031 upper / 0x2033 lower
+}  // namespace rxCB
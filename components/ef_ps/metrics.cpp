@@ -0,0 +1,10 @@
+#include "metrics.h"
+
+const char *MetricsRegistry::name(MetricId id) {
+  static const char *const kNames[MET_COUNT] = {
+    "rx_frames", "rx_queue_drops", "rx_messages", "rx_reassembly_drops",
+    "rx_timeouts", "rx_crc_errors", "rx_unhandled", "tx_frames", "tx_messages",
+    "tx_reply_drops", "tx_errors",
+  };
+  return (id < MET_COUNT) ? kNames[id] : "?";
+}
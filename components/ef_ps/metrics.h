@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+// Protocol counters, one registry per bridge (BridgeContext::metrics).
+//
+// Plain relaxed atomic increments: callable from the canbus callback, loop()
+// and the TX task, and readable from anywhere without a lock. Counters only
+// ever grow (and wrap at 2^32); rates are derived by the reader.
+
+enum MetricId : uint8_t {
+  MET_RX_FRAMES,        // frames through processEcoFlowCAN
+  MET_RX_QUEUE_DROPS,   // RX queue full, frame lost before processing
+  MET_RX_MESSAGES,      // 0x10x14001 messages reassembled
+  MET_RX_REASM_DROPS,   // partial messages discarded (evicted, truncated, oversize, timed out)
+  MET_RX_TIMEOUTS,      // ... of which timed out
+  MET_RX_CRC_ERRORS,    // reassembled messages with a bad CRC (rejected)
+  MET_RX_UNHANDLED,     // valid messages no rx_dispatch handler took
+  MET_TX_FRAMES,
+  MET_TX_MESSAGES,
+  MET_TX_REPLY_DROPS,   // reply queue full
+  MET_TX_ERRORS,        // frames the CAN driver refused (TX buffer full, bus off)
+  MET_COUNT
+};
+
+class MetricsRegistry {
+ public:
+  void inc(MetricId id) { c_[id].fetch_add(1, std::memory_order_relaxed); }
+  uint32_t get(MetricId id) const { return c_[id].load(std::memory_order_relaxed); }
+
+  // Reassembled RX messages per header msg_type
+  uint32_t incRxType(uint8_t type) { return rxType_[type].fetch_add(1, std::memory_order_relaxed) + 1; }
+  uint32_t rxType(uint8_t type) const { return rxType_[type].load(std::memory_order_relaxed); }
+
+  static const char *name(MetricId id);
+
+ private:
+  std::atomic<uint32_t> c_[MET_COUNT] = {};
+  std::atomic<uint32_t> rxType_[256] = {};
+};
@@ -0,0 +1,153 @@
+#include "reassembler.h"
+#include "ecoflow.h"   // streamDebug()
+#include "crc16.h"
+#include <string.h>
+#include <cstdio>
+
+Reassembler14001::Slot *Reassembler14001::newest() {
+  Slot *best = nullptr;
+  for (Slot &s : slots_)
+    if (s.active && (!best || (int32_t)(s.order - best->order) > 0)) best = &s;
+  return best;
+}
+
+Reassembler14001::Slot *Reassembler14001::acquire(uint32_t now) {
+  Slot *victim = nullptr;
+  for (Slot &s : slots_) {
+    if (!s.active) { victim = &s; break; }
+    if (!victim || (int32_t)(s.order - victim->order) < 0) victim = &s;
+  }
+  if (victim->active) {
+    stats_.evicted++;
+    streamDebug("14001 pool full — evicting oldest partial");
+    drop(*victim);
+  }
+  victim->active     = true;
+  victim->lenKnown   = false;
+  victim->payloadLen = 0;
+  victim->have       = 0;
+  victim->targetTotal = 0;
+  victim->folded     = 0;
+  victim->crc        = crc16Init();
+  victim->order      = order_++;
+  wheel_.arm(victim->timer, now + MSG14001_TIMEOUT_MS);
+  stats_.started++;
+  return victim;
+}
+
+bool Reassembler14001::append(Slot &s, uint8_t *buf, const uint8_t *data, uint8_t dlc, uint32_t now) {
+  if (dlc == 0) return true;
+  if (s.have + dlc > MSG14001_BUF_CAP) dlc = (uint8_t)(MSG14001_BUF_CAP - s.have); // clamp
+  memcpy(&buf[s.have], data, dlc);
+  s.have += dlc;
+  wheel_.arm(s.timer, now + MSG14001_TIMEOUT_MS);
+
+  // Determine payload length when we have first 4 header bytes
+  if (!s.lenKnown && s.have >= (IDX_LEN_HI + 1)) {
+    s.payloadLen = (uint16_t)buf[IDX_LEN_LO] | ((uint16_t)buf[IDX_LEN_HI] << 8); // little-endian
+    // Guard against oversize messages
+    if (s.payloadLen > MSG14001_MAX_PAYLOAD) {
+      char m[96];
+      snprintf(m, sizeof(m), "14001 oversize payload %u > cap %u — dropping",
+               s.payloadLen, (unsigned)MSG14001_MAX_PAYLOAD);
+      streamDebug(m);
+      stats_.oversize++;
+      drop(s);
+      return false;
+    }
+    s.targetTotal = (size_t)MSG14001_HDR_LEN + (size_t)s.payloadLen + 2U;
+    s.lenKnown = true;
+  }
+  foldAndDecode(s, buf);
+  return true;
+}
+
+void Reassembler14001::foldAndDecode(Slot &s, uint8_t *buf) {
+  // CRC covers everything before the trailer, as encoded on the wire
+  size_t end = s.have;
+  if (s.lenKnown && end > s.targetTotal - 2) end = s.targetTotal - 2;
+  if (end <= s.folded) return;
+  s.crc = crc16Update(s.crc, &buf[s.folded], end - s.folded);
+
+  // payload starts after the header, which carries the key
+  const uint8_t key = buf[IDX_XOR];
+  for (size_t i = (s.folded > MSG14001_HDR_LEN) ? s.folded : MSG14001_HDR_LEN; i < end; i++)
+    buf[i] ^= key;
+  s.folded = end;
+}
+
+const Msg14001 *Reassembler14001::feed(uint32_t id, const uint8_t *data, uint8_t dlc, uint32_t now) {
+  const uint32_t fullID = id & 0x1FFFFFFF;
+  Slot *s;
+
+  if (fullID == MSG14001_START_ID) {
+    s = acquire(now);
+  } else if (fullID == MSG14001_MID_ID || fullID == MSG14001_END_ID) {
+    s = newest();
+    if (!s) return nullptr;   // continuation without a start
+  } else {
+    return nullptr;
+  }
+
+  uint8_t *buf = bufOf(*s);
+  if (!append(*s, buf, data, dlc, now)) return nullptr;
+  if (fullID != MSG14001_END_ID) return nullptr;
+
+  if (!s->lenKnown || s->have < s->targetTotal) {
+    // Sender finished but we are short: a frame went missing
+    stats_.truncated++;
+    streamDebug("14001 end before announced length — dropping");
+    drop(*s);
+    return nullptr;
+  }
+
+  const size_t total = s->targetTotal;
+  uint16_t crc  = (uint16_t)buf[total - 2] | ((uint16_t)buf[total - 1] << 8);   // LE
+  const uint16_t calc = crc16Final(s->crc);
+  release(*s);
+  if (calc != crc && calc == (uint16_t)((crc << 8) | (crc >> 8))) {
+    // Some senders put the CRC hi byte first: accept it, but count it
+    stats_.crcSwapped++;
+    crc = calc;
+  }
+  if (calc != crc) {
+    char m[64];
+    snprintf(m, sizeof(m), "14001 CRC mismatch %04X != %04X", calc, crc);
+    streamDebug(m);
+    stats_.crcErrors++;
+    count(MET_RX_CRC_ERRORS);
+#if MSG14001_VERIFY_CRC
+    return nullptr;
+#endif
+  }
+
+  stats_.completed++;
+  done_.buf        = buf;
+  done_.payloadLen = s->payloadLen;
+  done_.total      = total;
+  done_.crc        = crc;
+  return &done_;
+}
+
+void Reassembler14001::expire(uint32_t now) {
+  wheel_.advance(now, [this](TimerNode &n) {
+    for (Slot &s : slots_) {
+      if (&s.timer != &n || !s.active) continue;
+      streamDebug("14001 timeout — reset");
+      stats_.timedOut++;
+      count(MET_RX_TIMEOUTS);
+      drop(s);
+    }
+  });
+}
+
+void Reassembler14001::drop(Slot &s) {
+  count(MET_RX_REASM_DROPS);
+  release(s);
+}
+
+uint8_t Reassembler14001::inFlight() const {
+  uint8_t n = 0;
+  for (const Slot &s : slots_) n += s.active ? 1 : 0;
+  return n;
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "timer_wheel.h"
+#include "metrics.h"
+
+// 14001 IDs
+#define MSG14001_START_ID   0x10014001UL
+#define MSG14001_MID_ID     0x10114001UL
+#define MSG14001_END_ID     0x10214001UL
+
+// Fixed parts
+#define MSG14001_HDR_LEN    18
+#define MSG14001_TIMEOUT_MS 300
+
+// Header indices
+#define IDX_TYPE   4   // msg_type
+#define IDX_XOR    6   // XOR key (unencoded)
+#define IDX_LEN_LO 2   // payload length (lo)
+#define IDX_LEN_HI 3   // payload length (hi)
+#define IDX_TRK0   16  // tracker = last 4 header bytes
+#define IDX_TRK1   17
+
+#ifndef MSG14001_MAX_PAYLOAD
+#define MSG14001_MAX_PAYLOAD 2048
+#endif
+#define MSG14001_BUF_CAP (MSG14001_HDR_LEN + MSG14001_MAX_PAYLOAD + 2)
+
+// Reject messages whose CRC16 (over header + encoded payload) does not
+// match. The CRC is sent LE; a BE one is accepted and counted in crcSwapped.
+// 0 only counts the mismatches and still delivers the message.
+#ifndef MSG14001_VERIFY_CRC
+#define MSG14001_VERIFY_CRC 1
+#endif
+
+// Number of messages that may be in flight at once
+#ifndef MSG14001_SLOTS
+#define MSG14001_SLOTS 3
+#endif
+
+// A fully reassembled, CRC-checked 14001 message. The payload has already
+// been XOR-decoded in place; the header (incl. the key at IDX_XOR) is as sent.
+struct Msg14001 {
+  const uint8_t *buf;     // header + decoded payload + CRC
+  uint16_t payloadLen;
+  size_t   total;         // MSG14001_HDR_LEN + payloadLen + 2
+  uint16_t crc;           // received CRC (a BE one stored swapped to LE)
+};
+
+struct Reassembler14001Stats {
+  uint32_t started;
+  uint32_t completed;
+  uint32_t evicted;       // in-flight message pushed out by a new start (pool full)
+  uint32_t timedOut;
+  uint32_t truncated;     // end frame seen before the announced length
+  uint32_t oversize;
+  uint32_t crcErrors;
+  uint32_t crcSwapped;    // CRC matched only with its bytes in BE order
+};
+
+// Reassembles 0x10x14001 multi-frame messages into a small fixed pool of
+// slab buffers. A start frame always opens a new slot, so a message that
+// begins before the previous one has finished (e.g. a DE query right behind
+// a C4 heartbeat) no longer discards it. Mid/end frames go to the most
+// recently started slot; once that slot completes, later frames continue
+// the older one.
+//
+// Each frame is folded into the slot's running CRC and its payload bytes are
+// XOR-decoded in place as it arrives, so completing a message costs only the
+// CRC compare and no second pass or buffer is needed.
+class Reassembler14001 {
+ public:
+  // Feed one frame. Returns the completed message, valid until the next
+  // call to feed(), or nullptr.
+  const Msg14001 *feed(uint32_t id, const uint8_t *data, uint8_t dlc, uint32_t now);
+
+  // Drop slots idle for longer than MSG14001_TIMEOUT_MS. Deadlines live in a
+  // timer wheel, so this only visits the buckets that elapsed since the last
+  // call; run it from loop() so stalls are reset even when the bus is quiet.
+  void expire(uint32_t now);
+
+  uint8_t inFlight() const;
+  const Reassembler14001Stats &stats() const { return stats_; }
+  // Registry for the MET_RX_* drop/CRC counters; none by default
+  void setMetrics(MetricsRegistry *m) { metrics_ = m; }
+
+ private:
+  struct Slot {
+    bool     active;
+    bool     lenKnown;
+    uint16_t payloadLen;
+    size_t   have;
+    size_t   targetTotal;
+    size_t   folded;      // bytes folded into crc (and decoded, past the header)
+    uint16_t crc;
+    uint32_t order;       // start sequence, newest = highest
+    TimerNode timer;      // idle deadline
+  };
+
+  Slot *newest();
+  Slot *acquire(uint32_t now);
+  void release(Slot &s) { wheel_.cancel(s.timer); s.active = false; }
+  void drop(Slot &s);
+  void count(MetricId id) { if (metrics_) metrics_->inc(id); }
+  bool append(Slot &s, uint8_t *buf, const uint8_t *data, uint8_t dlc, uint32_t now);
+  void foldAndDecode(Slot &s, uint8_t *buf);
+  uint8_t *bufOf(const Slot &s) { return slab_[&s - slots_]; }
+
+  Slot    slots_[MSG14001_SLOTS] = {};
+  uint8_t slab_[MSG14001_SLOTS][MSG14001_BUF_CAP];
+  TimerWheel<32, 16> wheel_;   // 512 ms span > MSG14001_TIMEOUT_MS
+  uint32_t order_ = 0;
+  Msg14001 done_ = {};
+  Reassembler14001Stats stats_ = {};
+  MetricsRegistry *metrics_ = nullptr;
+};
@@ -0,0 +1,78 @@
+#include "rx_dispatch.h"
+#include "message_schema.h"
+
+static_assert((EF_RX_HANDLERS & (EF_RX_HANDLERS - 1)) == 0, "EF_RX_HANDLERS must be a power of two");
+
+// Plain data, zero-initialised before any constructor runs, so other
+// translation units may register from their static initialisers.
+struct RxHandlerSlot {
+  uint32_t    key;     // 0 = empty, else 1 << 25 | type << 17 | tracker
+  RxHandlerFn fn;
+  void       *arg;
+};
+
+static RxHandlerSlot g_rxHandlers[EF_RX_HANDLERS];
+static uint16_t g_rxHandlerCount;
+
+// tracker (incl. RX_TRACKER_ANY) in bits 0..16, type in 17..24, occupied in 25
+static inline uint32_t rxKey(uint8_t type, uint32_t tracker) {
+  return (1u << 25) | ((uint32_t)type << 17) | (tracker & 0x1FFFFu);
+}
+
+static inline uint32_t rxSlot(uint32_t key) {
+  return (key * 0x9E3779B1u) >> 16;   // Fibonacci hash; masked by the caller
+}
+
+bool rxHandlerRegister(uint8_t type, uint32_t tracker, RxHandlerFn fn, void *arg) {
+  if (!fn || tracker > RX_TRACKER_ANY) return false;
+  // keep a quarter free so every probe run ends at an empty slot quickly
+  if (g_rxHandlerCount >= EF_RX_HANDLERS * 3 / 4) return false;
+
+  const uint32_t key = rxKey(type, tracker);
+  uint32_t i = rxSlot(key);
+  while (g_rxHandlers[i & (EF_RX_HANDLERS - 1)].key) i++;
+  g_rxHandlers[i & (EF_RX_HANDLERS - 1)] = {key, fn, arg};
+  g_rxHandlerCount++;
+  return true;
+}
+
+static bool runHandlers(uint32_t key, BridgeContext &ctx, const RxMessage &msg) {
+  bool any = false;
+  for (uint32_t i = rxSlot(key);; i++) {
+    const RxHandlerSlot &s = g_rxHandlers[i & (EF_RX_HANDLERS - 1)];
+    if (!s.key) return any;
+    if (s.key != key) continue;
+    s.fn(ctx, msg, s.arg);
+    any = true;
+  }
+}
+
+bool rxDispatch(BridgeContext &ctx, const RxMessage &msg) {
+  const bool exact = runHandlers(rxKey(msg.type, msg.tracker), ctx, msg);
+  const bool wild  = runHandlers(rxKey(msg.type, RX_TRACKER_ANY), ctx, msg);
+  return exact || wild;
+}
+
+template <size_t W>
+static uint32_t rxLoad(const uint8_t *p, bool bigEndian) {
+  return bigEndian ? schema::load<W, schema::Endian::Big>(p) : schema::load<W, schema::Endian::Little>(p);
+}
+
+bool rxReadField(const RxMessage &msg, const RxField &f, int64_t *out) {
+  if ((uint32_t)f.offset + f.width > msg.payloadLen) return false;
+  const uint8_t *p = msg.payload + f.offset;
+  uint32_t raw;
+  switch (f.width) {
+    case 1: raw = rxLoad<1>(p, f.bigEndian); break;
+    case 2: raw = rxLoad<2>(p, f.bigEndian); break;
+    case 4: raw = rxLoad<4>(p, f.bigEndian); break;
+    default: return false;
+  }
+  if (f.isSigned) {
+    const unsigned shift = 32 - 8 * f.width;
+    *out = (int32_t)(raw << shift) >> shift;
+  } else {
+    *out = raw;
+  }
+  return true;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+struct BridgeContext;
+
+// Table-driven dispatch of reassembled 0x10x14001 messages.
+//
+// Handlers are keyed by (msg_type, tracker) in a small open-addressing hash
+// table, so a message costs two short probe runs however many handlers are
+// registered. Types nobody handles only bump the rx_unhandled counter.
+// The built-in C4/DE/CB handlers are registered by ecoflow.cpp; components
+// add their own (e.g. for more telemetry) from C++ or YAML `on_message`.
+
+// One reassembled, CRC-checked message as handlers see it
+struct RxMessage {
+  const uint8_t *header;      // MSG14001_HDR_LEN bytes, as sent
+  const uint8_t *payload;     // XOR-decoded
+  uint16_t payloadLen;
+  uint8_t  type;              // header[IDX_TYPE]
+  uint8_t  key;               // header[IDX_XOR]
+  uint16_t tracker;           // header[IDX_TRK0..1], big-endian
+  uint16_t crc;
+  uint32_t finishedUs;        // EF_MICROS() when the last frame arrived
+  uint32_t typeCount;         // messages of this type so far, incl. this one
+};
+
+typedef void (*RxHandlerFn)(BridgeContext &ctx, const RxMessage &msg, void *arg);
+
+#define RX_TRACKER_ANY 0x10000u   // every tracker of a msg_type
+
+#ifndef EF_RX_HANDLERS
+#define EF_RX_HANDLERS 32         // table slots, power of two; at most 3/4 used
+#endif
+
+// Add a handler for (type, tracker), tracker may be RX_TRACKER_ANY. Keys may
+// repeat: exact-tracker handlers run before RX_TRACKER_ANY ones, each in
+// registration order. Register from setup, before frames are processed.
+// Returns false when the table is full.
+bool rxHandlerRegister(uint8_t type, uint32_t tracker, RxHandlerFn fn, void *arg = nullptr);
+
+// Run every handler registered for `msg`. Returns false if there was none.
+bool rxDispatch(BridgeContext &ctx, const RxMessage &msg);
+
+// A payload field described at run time (YAML telemetry sensors); typed
+// layouts known at compile time use schema::View instead
+struct RxField {
+  uint16_t offset;
+  uint8_t  width;       // 1, 2 or 4
+  bool     bigEndian;
+  bool     isSigned;
+};
+
+// Read `f` straight from the payload. False if the payload is too short.
+bool rxReadField(const RxMessage &msg, const RxField &f, int64_t *out);
@@ -0,0 +1,155 @@
+#include "socketcan.h"
+
+#if defined(__linux__)
+
+#include "bridge_context.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <net/if.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <linux/can.h>
+#include <linux/can/raw.h>
+
+static_assert((EF_SOCKETCAN_TXQ & (EF_SOCKETCAN_TXQ - 1)) == 0, "EF_SOCKETCAN_TXQ must be a power of two");
+
+bool SocketCanBus::open(const char *ifname) {
+  close();
+  strncpy(name_, ifname, sizeof(name_) - 1);
+
+  const int fd = socket(PF_CAN, SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC, CAN_RAW);
+  if (fd < 0) return false;
+
+  ifreq ifr = {};
+  strncpy(ifr.ifr_name, ifname, IFNAMSIZ - 1);
+  if (ioctl(fd, SIOCGIFINDEX, &ifr) < 0) { const int e = errno; ::close(fd); errno = e; return false; }
+
+  // Own TX frames are not looped back to this socket; errors are ignored
+  const int off = 0;
+  setsockopt(fd, SOL_CAN_RAW, CAN_RAW_RECV_OWN_MSGS, &off, sizeof(off));
+
+  sockaddr_can addr = {};
+  addr.can_family  = AF_CAN;
+  addr.can_ifindex = ifr.ifr_ifindex;
+  if (bind(fd, (sockaddr *)&addr, sizeof(addr)) < 0) { const int e = errno; ::close(fd); errno = e; return false; }
+
+  fd_ = fd;
+  txHead_ = txTail_ = 0;
+  return true;
+}
+
+void SocketCanBus::close() {
+  if (fd_ >= 0) ::close(fd_);
+  fd_ = -1;
+}
+
+void SocketCanBus::send(void *arg, uint32_t id, const uint8_t *data, uint8_t len) {
+  SocketCanBus &bus = *static_cast<SocketCanBus *>(arg);
+  if (bus.pending() == EF_SOCKETCAN_TXQ) {
+    // keep queued frames; a message with a hole in it is lost either way
+    bus.flush();
+    if (bus.pending() == EF_SOCKETCAN_TXQ) { bus.stats_.txDropped++; return; }
+  }
+  TxFrame &f = bus.txq_[bus.txHead_ & (EF_SOCKETCAN_TXQ - 1)];
+  f.id  = id;
+  f.len = (len > 8) ? 8 : len;
+  memcpy(f.data, data, f.len);
+  bus.txHead_++;
+}
+
+size_t SocketCanBus::flush() {
+  can_frame frames[EF_SOCKETCAN_BATCH];
+  iovec     iov[EF_SOCKETCAN_BATCH];
+  mmsghdr   msgs[EF_SOCKETCAN_BATCH];
+
+  while (fd_ >= 0 && pending()) {
+    unsigned n = 0;
+    for (uint32_t i = txTail_; i != txHead_ && n < EF_SOCKETCAN_BATCH; i++, n++) {
+      const TxFrame &f = txq_[i & (EF_SOCKETCAN_TXQ - 1)];
+      can_frame &cf = frames[n];
+      memset(&cf, 0, sizeof(cf));
+      cf.can_id  = (f.id & CAN_EFF_MASK) | CAN_EFF_FLAG;
+      cf.can_dlc = f.len;
+      memcpy(cf.data, f.data, f.len);
+      iov[n].iov_base = &cf;
+      iov[n].iov_len  = sizeof(cf);
+      memset(&msgs[n], 0, sizeof(msgs[n]));
+      msgs[n].msg_hdr.msg_iov    = &iov[n];
+      msgs[n].msg_hdr.msg_iovlen = 1;
+    }
+
+    const int sent = sendmmsg(fd_, msgs, n, MSG_DONTWAIT);
+    if (sent < 0) {
+      if (errno == EINTR) continue;
+      if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS) { stats_.txRetries++; break; }
+      // interface down or similar: drop what we have rather than spin
+      stats_.errors++;
+      txTail_ = txHead_;
+      break;
+    }
+    stats_.txCalls++;
+    stats_.txFrames += (uint32_t)sent;
+    txTail_ += (uint32_t)sent;
+    if ((unsigned)sent < n) { stats_.txRetries++; break; }
+  }
+  return pending();
+}
+
+static void feedBridge(void *arg, uint32_t id, const uint8_t *data, uint8_t len) {
+  ef_twai_message_t rx = {};
+  rx.extd = (id & CAN_EFF_FLAG) != 0;
+  rx.identifier = id & (rx.extd ? CAN_EFF_MASK : CAN_SFF_MASK);
+  rx.data_length_code = len;
+  memcpy(rx.data, data, len);
+  BridgeContext &ctx = *static_cast<BridgeContext *>(arg);
+  canRxRecordLoad(ctx, rx);
+  processEcoFlowCAN(ctx, rx);
+}
+
+int SocketCanBus::receive(BridgeContext &ctx) {
+  return receive(feedBridge, &ctx);
+}
+
+int SocketCanBus::receive(FrameSink sink, void *arg) {
+  can_frame frames[EF_SOCKETCAN_BATCH];
+  iovec     iov[EF_SOCKETCAN_BATCH];
+  mmsghdr   msgs[EF_SOCKETCAN_BATCH];
+  int total = 0;
+
+  for (;;) {
+    for (unsigned i = 0; i < EF_SOCKETCAN_BATCH; i++) {
+      iov[i].iov_base = &frames[i];
+      iov[i].iov_len  = sizeof(frames[i]);
+      memset(&msgs[i], 0, sizeof(msgs[i]));
+      msgs[i].msg_hdr.msg_iov    = &iov[i];
+      msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    const int n = recvmmsg(fd_, msgs, EF_SOCKETCAN_BATCH, MSG_DONTWAIT, nullptr);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+      stats_.errors++;
+      return -1;
+    }
+    if (n == 0) break;
+    if (msgs[0].msg_len == 0) { stats_.errors++; errno = ENOTCONN; return -1; }   // socket shut down
+    stats_.rxCalls++;
+
+    for (int i = 0; i < n; i++) {
+      const can_frame &cf = frames[i];
+      if (msgs[i].msg_len < sizeof(can_frame)) continue;      // CAN FD / short read
+      if (cf.can_id & (CAN_ERR_FLAG | CAN_RTR_FLAG)) continue;
+
+      sink(arg, cf.can_id & (CAN_EFF_FLAG | CAN_EFF_MASK), cf.data, (cf.can_dlc > 8) ? 8 : cf.can_dlc);
+    }
+    stats_.rxFrames += (uint32_t)n;
+    total += n;
+    if (n < EF_SOCKETCAN_BATCH) break;
+  }
+  return total;
+}
+
+#endif  // __linux__
@@ -0,0 +1,77 @@
+#pragma once
+
+// Linux SocketCAN transport for a BridgeContext (can0, vcan0, ...).
+//
+// One raw CAN socket per bus, non-blocking, meant to sit in an epoll loop:
+//   RX  receive() drains the socket with recvmmsg() in batches and feeds
+//       every frame straight to processEcoFlowCAN(ctx).
+//   TX  send() (the bridge's BridgeSendFn) only appends to a batch;
+//       flush() hands the batch to sendmmsg(). Frames the kernel cannot
+//       take yet (EAGAIN/ENOBUFS on a full txqueue) stay queued in order
+//       until the socket is writable again.
+//
+// Built only on Linux; ESP targets compile this to nothing.
+
+#if defined(__linux__)
+
+#include <stdint.h>
+#include <stddef.h>
+
+struct BridgeContext;
+
+#ifndef EF_SOCKETCAN_BATCH
+#define EF_SOCKETCAN_BATCH 32     // frames per recvmmsg()/sendmmsg() call
+#endif
+#ifndef EF_SOCKETCAN_TXQ
+#define EF_SOCKETCAN_TXQ   256    // pending TX frames, power of two
+#endif
+
+struct SocketCanStats {
+  uint32_t rxFrames;
+  uint32_t rxCalls;      // recvmmsg() calls that returned frames
+  uint32_t txFrames;
+  uint32_t txCalls;
+  uint32_t txDropped;    // TX queue full
+  uint32_t txRetries;    // flush() stopped on EAGAIN/ENOBUFS
+  uint32_t errors;
+};
+
+class SocketCanBus {
+ public:
+  ~SocketCanBus() { close(); }
+
+  // Bind a raw CAN socket to `ifname`. Returns false (errno set) on failure.
+  bool open(const char *ifname);
+  void close();
+  int fd() const { return fd_; }
+  const char *name() const { return name_; }
+
+  // BridgeSendFn: `arg` is the SocketCanBus
+  static void send(void *arg, uint32_t id, const uint8_t *data, uint8_t len);
+
+  // Hand queued frames to the kernel. Returns frames still pending; non-zero
+  // means wait for EPOLLOUT before the next flush.
+  size_t flush();
+  size_t pending() const { return txHead_ - txTail_; }
+
+  // Read everything available and run it through processEcoFlowCAN(ctx).
+  // Returns frames processed, -1 on socket error.
+  int receive(BridgeContext &ctx);
+  // Same, handing each data frame to `sink`; `id` has CAN_EFF_FLAG set for
+  // extended frames
+  typedef void (*FrameSink)(void *arg, uint32_t id, const uint8_t *data, uint8_t len);
+  int receive(FrameSink sink, void *arg);
+
+  const SocketCanStats &stats() const { return stats_; }
+
+ private:
+  struct TxFrame { uint32_t id; uint8_t len; uint8_t data[8]; };
+
+  int  fd_ = -1;
+  char name_[16] = {0};
+  TxFrame  txq_[EF_SOCKETCAN_TXQ];
+  uint32_t txHead_ = 0, txTail_ = 0;
+  SocketCanStats stats_ = {};
+};
+
+#endif  // __linux__
@@ -1,4 +1,5 @@
 #include "ecoflow.h"
+#include "clock.h"
 #include <stdio.h>
 
 // Minimal stub implementations to allow local build/tests.
@@ -14,22 +15,15 @@ float BMS::get_balance_capacity() { return 0.0f; }
 #if !defined(ARDUINO) && !defined(ESP32) && !defined(ESP8266)
 void streamDebug(const char *msg) { (void)msg; }
 void streamCanLog(const char *msg) { (void)msg; }
-double now_seconds() { return 0.0; }
-uint32_t millis() { return 0; }
+double now_seconds() { return (double)clockNowUs() / 1000000.0; }
+uint32_t millis() { return clockMillis(); }
 void taskYIELD() {}
-int random(int a, int b) { return a; }
+int random(int a, int) { return a; }
 #else
 #include "esphome/core/log.h"
 void streamDebug(const char *msg) { ESP_LOGD("ef_ps", "%s", msg); }
 void streamCanLog(const char *msg) { ESP_LOGD("ef_ps", "%s", msg); }
-double now_seconds() {
-#if defined(ESP32) || defined(ESP8266)
-#include <esp_timer.h>
-	return (double)esp_timer_get_time() / 1000000.0;
-#else
-	return (double)millis() / 1000.0;
-#endif
-}
+double now_seconds() { return (double)clockNowUs() / 1000000.0; }
 #endif
 
 // empty implementations for web.h dependencies (if any)
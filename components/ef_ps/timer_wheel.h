@@ -0,0 +1,71 @@
+#pragma once
+
+#include <stdint.h>
+
+// Minimal hashed timer wheel for millisecond deadlines.
+//
+// Nodes are intrusive and owned by the caller; arm/cancel are O(1) list
+// splices, and advance() only touches the buckets that elapsed since the
+// previous call. Deadlines further out than BUCKETS * TICK_MS stay in their
+// bucket until a later lap reaches them.
+struct TimerNode {
+  TimerNode *prev = nullptr;
+  TimerNode *next = nullptr;
+  uint32_t   deadline = 0;
+  bool armed() const { return prev != nullptr; }
+};
+
+template <uint8_t BUCKETS, uint16_t TICK_MS>
+class TimerWheel {
+  static_assert((BUCKETS & (BUCKETS - 1)) == 0, "BUCKETS must be a power of two");
+
+ public:
+  TimerWheel() {
+    for (TimerNode &b : buckets_) b.prev = b.next = &b;
+  }
+
+  void arm(TimerNode &n, uint32_t deadline) {
+    cancel(n);
+    n.deadline = deadline;
+    TimerNode &b = buckets_[(deadline / TICK_MS) & (BUCKETS - 1)];
+    n.prev = b.prev;
+    n.next = &b;
+    b.prev->next = &n;
+    b.prev = &n;
+  }
+
+  void cancel(TimerNode &n) {
+    if (!n.armed()) return;
+    n.prev->next = n.next;
+    n.next->prev = n.prev;
+    n.prev = n.next = nullptr;
+  }
+
+  // Fire `fn(node)` for every node whose deadline has passed at `now`.
+  // The node is disarmed before the callback runs.
+  template <typename Fn>
+  void advance(uint32_t now, Fn fn) {
+    const uint32_t target = now / TICK_MS;
+    if (!started_) { tick_ = target; started_ = true; }
+    uint32_t steps = target - tick_ + 1;
+    if (steps > BUCKETS) steps = BUCKETS;
+
+    for (uint32_t i = 0; i < steps; i++) {
+      TimerNode &b = buckets_[(tick_ + i) & (BUCKETS - 1)];
+      for (TimerNode *n = b.next; n != &b;) {
+        TimerNode *nx = n->next;
+        if ((int32_t)(now - n->deadline) >= 0) {
+          cancel(*n);
+          fn(*n);
+        }
+        n = nx;
+      }
+    }
+    tick_ = target;
+  }
+
+ private:
+  TimerNode buckets_[BUCKETS];   // list heads
+  uint32_t  tick_ = 0;
+  bool      started_ = false;
+};
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <stdint.h>
+
+// Which TX messages the firmware can send, and the kSeq step table.
+//
+// By default every message is compiled in and the runtime
+// config.messageXX flags decide what goes out. With `tx_messages` or
+// `tx_schedule` in the ef_ps YAML, __init__.py generates ef_ps_schedule.h
+// and builds with -DEF_PS_SCHEDULE_H instead. The message set is then fixed
+// at build time. Messages left out lose their headers, payload templates
+// and per-bridge buffers, and kSeq only holds steps that send something.
+// canTxEnabled and the config.messageXX flags of the messages compiled in
+// stay runtime switches either way.
+
+// TX message bits, usable in #if
+#define TXM_70  (1u << 0)
+#define TXM_0B  (1u << 1)
+#define TXM_4F  (1u << 2)
+#define TXM_68  (1u << 3)
+#define TXM_13  (1u << 4)
+#define TXM_CB  (1u << 5)   // sequencer CB steps and the CB 0x2031/0x2033 acks
+#define TXM_5C  (1u << 6)
+#define TXM_24  (1u << 7)   // reply to DE 0x0141
+#define TXM_8C  (1u << 8)   // reply to DE 0x0105
+#define TXM_3C  (1u << 9)   // reply to C4
+#define TXM_ALL 0x3FFu
+
+// Action Sequencer definitions
+enum TxAction : uint8_t {
+  A_70,
+  A_0B_04, A_0B_02, A_0B_05, A_0B_50, A_0B_08,
+  A_4F,
+  A_68,
+  A_13,
+  A_CB_321, A_CB_141,
+  A_5C,
+  A_CB_150,
+  A_IDLE,   // sends nothing; keeps the cycle when no periodic message is built in
+};
+
+// One cycle step: each action and the gap in ms
+struct Step { TxAction act; uint16_t gap_ms; };
+
+#ifdef EF_PS_SCHEDULE_H
+#include "ef_ps_schedule.h"   // EF_TX_MESSAGES and kSeq, generated from YAML
+#else
+#define EF_TX_MESSAGES TXM_ALL
+
+// Keep in step with DEFAULT_TX_SCHEDULE in __init__.py
+static constexpr Step kSeq[] = {
+  {A_70,     25},
+  {A_0B_04,   1},
+  {A_0B_02,   1},
+  {A_0B_05,   1},
+  {A_0B_50,   1},
+  {A_0B_08, 100},
+  {A_4F,    100},
+  {A_0B_04,   1},
+  {A_0B_02,   1},
+  {A_0B_05,   1},
+  {A_0B_50,   1},
+  {A_0B_08, 100},
+  {A_68,     4},
+  {A_13,     1},
+  {A_CB_321, 1},
+  {A_CB_141, 1},
+  {A_5C,     1},
+  {A_CB_150,100},
+  {A_0B_04,  1},
+  {A_0B_02,  1},
+  {A_0B_05,  1},
+  {A_0B_50,  1},
+  {A_0B_08,200},
+};
+#endif
+
+// Message compiled in at all (M = 70, 0B, ...); also valid in #if
+#define EF_TX_HAS(M) ((EF_TX_MESSAGES & TXM_##M) != 0)
+
+// Message may be sent now: compiled in and enabled by its runtime flag.
+// For a message left out this folds to false and the flag is never read.
+#define EF_TX_ON(cfg, M) (EF_TX_HAS(M) && (cfg).message##M)
@@ -0,0 +1,91 @@
+#include "tx_task.h"
+#include "bridge_context.h"
+#include <atomic>
+
+static std::atomic<bool> g_txTaskRun{false};
+
+static uint32_t nextSleepMs() {
+  uint32_t wait = bridgeTickAll();
+  return (wait > EF_TX_TASK_IDLE_MS) ? EF_TX_TASK_IDLE_MS : wait;
+}
+
+#if defined(ESP32)
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+static TaskHandle_t g_txTask = nullptr;
+
+static void txTaskMain(void *) {
+  while (g_txTaskRun.load(std::memory_order_relaxed)) {
+    uint32_t wait = nextSleepMs();
+    // A step already due (the 1 ms gaps, or a sub-tick remainder) only
+    // yields to tasks of the same priority instead of losing a whole tick
+    TickType_t ticks = pdMS_TO_TICKS(wait);
+    if (ticks) vTaskDelay(ticks);
+    else taskYIELD();
+  }
+  g_txTask = nullptr;
+  vTaskDelete(nullptr);
+}
+
+bool txTaskStart() {
+  if (g_txTask) return true;
+  g_txTaskRun = true;
+#if portNUM_PROCESSORS > 1
+  const BaseType_t core = 1;   // keep off the WiFi/BT core
+#else
+  const BaseType_t core = 0;
+#endif
+  if (xTaskCreatePinnedToCore(txTaskMain, "ef_tx", EF_TX_TASK_STACK, nullptr,
+                              EF_TX_TASK_PRIORITY, &g_txTask, core) != pdPASS) {
+    g_txTaskRun = false;
+    g_txTask = nullptr;
+    return false;
+  }
+  return true;
+}
+
+void txTaskStop() { g_txTaskRun = false; }
+
+bool txTaskRunning() { return g_txTask != nullptr; }
+
+#elif defined(__linux__)
+#include <errno.h>
+#include <thread>
+#include <time.h>
+
+static std::thread g_txThread;
+
+static void txTaskMain() {
+  while (g_txTaskRun.load(std::memory_order_relaxed)) {
+    timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    uint32_t wait = nextSleepMs();
+    t.tv_nsec += (long)wait * 1000000L;
+    while (t.tv_nsec >= 1000000000L) { t.tv_nsec -= 1000000000L; t.tv_sec++; }
+    // absolute deadline, so a signal only resumes the same sleep
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &t, nullptr) == EINTR) {}
+  }
+}
+
+bool txTaskStart() {
+  if (g_txThread.joinable()) return true;
+  g_txTaskRun = true;
+  g_txThread = std::thread(txTaskMain);
+  return true;
+}
+
+void txTaskStop() {
+  g_txTaskRun = false;
+  if (g_txThread.joinable()) g_txThread.join();
+}
+
+bool txTaskRunning() { return g_txThread.joinable(); }
+
+#else
+
+bool txTaskStart() { return false; }
+void txTaskStop() {}
+bool txTaskRunning() { return false; }
+
+#endif
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdint.h>
+
+// Optional dedicated TX timing task (enable with `tx_task: true`, which
+// defines EF_PS_TX_TASK).
+//
+// ESPHome's loop() runs every ~8-16 ms, far too coarse for the 1 ms gaps in
+// kSeq. The task instead ticks every registered bridge (bridgeTickAll()) and
+// sleeps exactly until the soonest deadline:
+//   ESP32  pinned FreeRTOS task, vTaskDelay() on a 1 ms tick, taskYIELD()
+//          when the next step is already due
+//   Linux  std::thread, clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME)
+
+// Poll interval while the sequencer is stopped (waiting for a C4 heartbeat)
+#ifndef EF_TX_TASK_IDLE_MS
+#define EF_TX_TASK_IDLE_MS 10
+#endif
+
+#ifndef EF_TX_TASK_PRIORITY
+#define EF_TX_TASK_PRIORITY 5
+#endif
+
+#ifndef EF_TX_TASK_STACK
+#define EF_TX_TASK_STACK 4096
+#endif
+
+// Returns false when the platform has no task support or creation failed
+bool txTaskStart();
+void txTaskStop();
+bool txTaskRunning();
@@ -0,0 +1,181 @@
+// Host test: the ESPHome component sends and receives without touching the
+// heap once setup() is done.
+//
+// ef_ps.cpp is built against the stand-in ESPHome headers in tools/host_stubs.
+// Global operator new is replaced by a counting one; after a warm-up the
+// test runs kSeq cycles on a VirtualClock with C4 heartbeats and DE queries
+// arriving through the canbus callback, and fails on any allocation. A
+// second run makes the bus refuse frames and checks the tx_errors metric.
+// A second component on its own bus, configured only through its YAML
+// setters, runs alongside and must keep its own counters.
+//
+// Build (from the repository root):
+//   g++ -std=gnu++17 -O2 -Itools/host_stubs -Icomponents/ef_ps -o ef_ps_alloc_test
+//       tools/ef_ps_alloc_test.cpp components/ef_ps/*.cpp -lpthread
+
+#include "ef_ps.h"
+#include "frame_encoder.h"
+#include "reassembler.h"
+#include "clock.h"
+
+#include <atomic>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <utility>
+#include <vector>
+
+// ===== Counting allocator =====
+
+static std::atomic<bool> g_counting{false};
+static std::atomic<uint32_t> g_allocs{0};
+
+void *operator new(size_t n) {
+  if (g_counting.load(std::memory_order_relaxed)) g_allocs++;
+  void *p = malloc(n ? n : 1);
+  if (!p) throw std::bad_alloc();
+  return p;
+}
+void *operator new[](size_t n) { return operator new(n); }
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
+
+// ===== Bus =====
+
+class TestBus : public esphome::canbus::Canbus {
+ public:
+  uint32_t sent = 0;
+  uint32_t refused = 0;
+  uint32_t replies3C = 0;
+  uint32_t failEvery = 0;   // refuse every Nth frame; 0 = never
+
+ protected:
+  esphome::canbus::Error send_message(esphome::canbus::CanFrame *f) override {
+    if (failEvery && (this->sent + this->refused + 1) % this->failEvery == 0) {
+      this->refused++;
+      return esphome::canbus::ERROR_ALLTXBUSY;
+    }
+    this->sent++;
+    // first frame of a 3C reply (raw framing: type at byte 4)
+    if (f->can_id == 0x10003001UL && f->can_data_length_code == 8 && f->data[4] == 0x3C)
+      this->replies3C++;
+    return esphome::canbus::ERROR_OK;
+  }
+};
+
+// ===== Requests =====
+
+typedef std::vector<std::pair<uint32_t, std::vector<uint8_t>>> Frames;
+
+static void collect(void *arg, uint32_t id, const uint8_t *data, uint8_t len) {
+  static_cast<Frames *>(arg)->push_back({id, std::vector<uint8_t>(data, data + len)});
+}
+
+static Frames request(uint8_t type, uint16_t tracker, const uint8_t *payload, uint16_t len) {
+  Frames out;
+  const uint8_t key = 0x5A;
+  const uint8_t header[MSG14001_HDR_LEN] = {
+    0xAA, 0x03, (uint8_t)len, (uint8_t)(len >> 8), type, 0x2D, key, 0x00,
+    0x00, 0x00, 0x01, 0x4B, 0x14, 0x03, 0x01, 0x01,
+    (uint8_t)(tracker >> 8), (uint8_t)tracker
+  };
+  FrameEncoder enc(MSG14001_START_ID, MSG14001_MID_ID, MSG14001_END_ID, false, collect, &out);
+  enc.write(header, sizeof(header));
+  enc.writeXor(payload, len, key);
+  enc.finish();
+  return out;
+}
+
+// ===== Run =====
+
+struct Rig {
+  VirtualClock vc;
+  TestBus bus, bus2;
+  ef_ps::EfPsComponent comp, comp2;
+  Frames c4, de;
+};
+
+// `ms` of bus time in 1 ms steps: C4 every 500 ms, DE every 2 s, update() every 1 s
+static void run(Rig &r, uint32_t ms) {
+  for (uint32_t t = 0; t < ms; t++) {
+    const uint64_t now = clockNowUs() / 1000;
+    for (TestBus *bus : {&r.bus, &r.bus2}) {
+      if (now % 500 == 0)
+        for (auto &f : r.c4) bus->receive(f.first, true, f.second);
+      if (now % 2000 == 250)
+        for (auto &f : r.de) bus->receive(f.first, true, f.second);
+    }
+    r.comp.loop();
+    r.comp2.loop();
+    if (now % 1000 == 0) { r.comp.update(); r.comp2.update(); }
+    r.vc.advance(1000);
+  }
+}
+
+int main() {
+  static Rig r;
+  r.vc.install(1000000);
+
+  config.volt = 5120; config.soc = 75; config.temp = 25; config.chgvolt = 5600;
+  config.message70 = config.message0B = config.message4F = config.message68 = config.message13 = true;
+  config.messageCB = config.message5C = config.message24 = config.message8C = config.message3C = true;
+  config.canTxEnabled = true;
+
+  uint8_t c4[69] = {0};
+  memcpy(c4 + 3, "HW51ZEH4SF000001", 16);
+  const uint8_t de[4] = {0x01, 0x00, 0x00, 0x00};
+  r.c4 = request(0xC4, 0x0302, c4, sizeof(c4));
+  r.de = request(0xDE, 0x0105, de, sizeof(de));
+
+  // YAML options on the first instance only override what they name
+  r.comp.set_canbus(&r.bus);
+  r.comp.set_serial("HJ31ZDH4ZF7F0001");
+  r.comp.setup();
+  bool ok = config.volt == 5120 && config.canTxEnabled && !strncmp(config.serialStr, "HJ31ZDH4ZF7F0001", 16);
+
+  // Second instance: its config comes from the setters alone
+  r.comp2.set_canbus(&r.bus2);
+  r.comp2.set_can_tx_enabled(true);
+  r.comp2.set_serial("HJ31ZDH4ZF7F0002");
+  r.comp2.set_voltage(5200);
+  r.comp2.set_soc(60);
+  r.comp2.set_temperature(20);
+  r.comp2.set_charge_voltage(5600);
+  r.comp2.set_enabled_messages(TXM_ALL);
+  r.comp2.setup();
+  ok = ok && r.comp2.bridge()->config->volt == 5200 && config.volt == 5120;
+  run(r, 5000);   // first prepares, first replies, histogram buckets
+
+  // ---- zero allocations ----
+  const uint32_t sent0 = r.bus.sent, replies0 = r.bus.replies3C;
+  const uint32_t sent20 = r.bus2.sent, replies20 = r.bus2.replies3C;
+  g_counting = true;
+  run(r, 20000);
+  g_counting = false;
+  const uint32_t sent = r.bus.sent - sent0, replies = r.bus.replies3C - replies0;
+  const uint32_t sent2 = r.bus2.sent - sent20, replies2 = r.bus2.replies3C - replies20;
+  printf("alloc: %u/%u frames sent, %u/%u 3C replies, %u heap allocations\n",
+         (unsigned)sent, (unsigned)sent2, (unsigned)replies, (unsigned)replies2, (unsigned)g_allocs.load());
+  ok = ok && sent > 1000 && replies >= 30 && sent2 > 1000 && replies2 >= 30 && g_allocs.load() == 0;
+
+  // ---- refused frames are counted, on the refusing bridge only ----
+  const MetricsRegistry &m1 = r.comp.bridge()->metrics, &m2 = r.comp2.bridge()->metrics;
+  const uint32_t errors0 = m1.get(MET_TX_ERRORS);
+  const uint32_t frames0 = m1.get(MET_TX_FRAMES), frames20 = m2.get(MET_TX_FRAMES);
+  const uint32_t busSent0 = r.bus.sent, busSent20 = r.bus2.sent;
+  r.bus.failEvery = 7;
+  run(r, 2000);
+  const uint32_t errors = m1.get(MET_TX_ERRORS) - errors0;
+  printf("alloc: %u frames refused, tx_errors +%u / +%u\n", (unsigned)r.bus.refused, (unsigned)errors,
+         (unsigned)m2.get(MET_TX_ERRORS));
+  ok = ok && r.bus.refused > 0 && errors == r.bus.refused && m2.get(MET_TX_ERRORS) == 0;
+  // tx_frames counts frames handed to the bus, per bridge
+  ok = ok && m1.get(MET_TX_FRAMES) - frames0 == r.bus.sent - busSent0 + r.bus.refused &&
+       m2.get(MET_TX_FRAMES) - frames20 == r.bus2.sent - busSent20;
+
+  printf("%s\n", ok ? "PASS" : "FAIL");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,872 @@
+// Host benchmarks and timing checks for the protocol core.
+//
+//   ef_ps_bench crc      CRC16 engine vs the original per-byte table loop
+//   ef_ps_bench replay   14001 reassembly of sequential and interleaved streams
+//   ef_ps_bench verify   reassembly with CRC check and in-place decode vs plain copy
+//   ef_ps_bench txgap    gaps between messages sent by the TX task vs kSeq
+//                        (needs -DEF_PS_TX_TASK)
+//   ef_ps_bench cycle    CPU time per kSeq cycle and the bus-load meter's share
+//   ef_ps_bench spsc     RX queue under a producer thread at 1 Mbit/s line rate
+//   ef_ps_bench ctx      CPU per BridgeContext as the number of contexts grows
+//
+// Every mode checks its own results and exits non-zero on a mismatch, so CI
+// runs them as tests. Timings are printed but never fail a run.
+//
+// Build (from the repository root):
+//   g++ -std=gnu++17 -O2 -Icomponents/ef_ps -o ef_ps_bench tools/ef_ps_bench.cpp
+//       $(ls components/ef_ps/*.cpp | grep -v ef_ps.cpp) -lpthread
+// Add -DEF_CRC16_IMPL=1|2|4|8 to benchmark a specific CRC16 engine.
+
+#include "ecoflow.h"
+#include "crc16.h"
+#include "frame_encoder.h"
+#include "reassembler.h"
+#include "bridge_context.h"
+#include "tx_schedule.h"
+#include "tx_task.h"
+#include "clock.h"
+#include "spsc_queue.h"
+#include "bus_load.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_HAVE_TSC 1
+#else
+#define BENCH_HAVE_TSC 0
+#endif
+
+// The ESPHome default bridge is not used here
+void sendCANFrame(uint32_t, const uint8_t *, uint8_t) {}
+
+// ===== Timing =====
+
+static uint64_t wallNs() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t ticks() {
+#if BENCH_HAVE_TSC
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+// Keeps results alive without a store the compiler can drop
+static volatile uint32_t g_sink;
+
+// ===== crc =====
+
+// The loop sendCANMessage used before the CRC16 module: one 256-entry
+// lookup per byte from a table built at startup.
+static uint16_t crc16Reference(const uint8_t *data, size_t len) {
+  static uint16_t table[256];
+  if (!table[1]) {
+    for (int i = 0; i < 256; i++) {
+      uint16_t c = (uint16_t)i;
+      for (int b = 0; b < 8; b++) c = (c & 1) ? (uint16_t)((c >> 1) ^ 0xA001) : (uint16_t)(c >> 1);
+      table[i] = c;
+    }
+  }
+  uint16_t crc = 0;
+  for (size_t i = 0; i < len; i++) crc = (uint16_t)(table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8));
+  return crc;
+}
+
+static const char *crcEngineName() {
+  switch (EF_CRC16_IMPL) {
+    case EF_CRC16_NIBBLE: return "nibble";
+    case EF_CRC16_BYTE:   return "byte";
+    case EF_CRC16_SLICE4: return "slice4";
+    case EF_CRC16_SLICE8: return "slice8";
+  }
+  return "?";
+}
+
+struct CrcRun { double nsPerByte, ticksPerByte; };
+
+template <typename F>
+static CrcRun timeCrc(F fn, const uint8_t *buf, size_t len, size_t bytesTotal) {
+  const size_t iters = bytesTotal / len;
+  uint32_t acc = 0;
+  const uint64_t t0 = wallNs(), c0 = ticks();
+  for (size_t i = 0; i < iters; i++) acc += fn(buf + (i & 7), len);
+  const uint64_t c1 = ticks(), t1 = wallNs();
+  g_sink = acc;
+  const double bytes = (double)iters * len;
+  return {(t1 - t0) / bytes, (c1 - c0) / bytes};
+}
+
+static int benchCrc(int, char **) {
+  static uint8_t buf[4096 + 8];
+  srand(1);
+  for (size_t i = 0; i < sizeof(buf); i++) buf[i] = (uint8_t)rand();
+
+  // Correctness first: every length up to 600 at every alignment, split
+  // at every point for the incremental API.
+  for (size_t len = 0; len <= 600; len++) {
+    for (size_t off = 0; off < 8; off++) {
+      const uint16_t want = crc16Reference(buf + off, len);
+      if (crc16(buf + off, len) != want) {
+        fprintf(stderr, "crc: mismatch len=%zu off=%zu\n", len, off);
+        return 1;
+      }
+    }
+    for (size_t cut = 0; cut <= len && len <= 64; cut++) {
+      uint16_t c = crc16Init();
+      c = crc16Update(c, buf, cut);
+      c = crc16Update(c, buf + cut, len - cut);
+      if (crc16Final(c) != crc16Reference(buf, len)) {
+        fprintf(stderr, "crc: incremental mismatch len=%zu cut=%zu\n", len, cut);
+        return 1;
+      }
+    }
+  }
+
+  // 20 B is the smallest 14001 message, 150 B a typical kSeq message,
+  // 600 B the reassembly buffer; 4 KiB shows the steady-state rate.
+  static const size_t kLens[] = {20, 150, 600, 4096};
+  const size_t kBytes = 64u << 20;
+  printf("crc16 engine %s (%s)\n", crcEngineName(),
+         BENCH_HAVE_TSC ? "ticks = TSC reference cycles" : "no cycle counter");
+  printf("  %6s %12s %12s %12s %12s %8s\n", "len", "ref ns/B", "ref tick/B", "new ns/B", "new tick/B", "speedup");
+  for (size_t len : kLens) {
+    const CrcRun ref = timeCrc(crc16Reference, buf, len, kBytes);
+    const CrcRun cur = timeCrc([](const uint8_t *d, size_t n) { return crc16(d, n); }, buf, len, kBytes);
+    printf("  %6zu %12.3f %12.3f %12.3f %12.3f %7.2fx\n", len,
+           ref.nsPerByte, ref.ticksPerByte, cur.nsPerByte, cur.ticksPerByte,
+           cur.nsPerByte > 0 ? ref.nsPerByte / cur.nsPerByte : 0.0);
+  }
+  printf("PASS\n");
+  return 0;
+}
+
+// ===== Frame streams =====
+
+struct Frame {
+  uint32_t id;
+  uint8_t  len;
+  uint8_t  data[8];
+};
+
+// One 14001 request as the inverter sends it
+struct Request {
+  uint8_t  type;
+  uint16_t tracker;
+  uint8_t  key;
+  uint8_t  payload[96];
+  uint16_t len;
+};
+
+static void collectFrame(void *arg, uint32_t id, const uint8_t *data, uint8_t len) {
+  Frame f = {id, len, {}};
+  memcpy(f.data, data, len);
+  static_cast<std::vector<Frame> *>(arg)->push_back(f);
+}
+
+static std::vector<Frame> encodeMessage(uint8_t type, uint16_t tracker, uint8_t key,
+                                        const uint8_t *payload, uint16_t len) {
+  std::vector<Frame> out;
+  const uint8_t header[MSG14001_HDR_LEN] = {
+    0xAA, 0x03, (uint8_t)len, (uint8_t)(len >> 8), type, 0x2D, key, 0x00,
+    0x00, 0x00, 0x01, 0x4B, 0x14, 0x03, 0x01, 0x01,
+    (uint8_t)(tracker >> 8), (uint8_t)tracker
+  };
+  FrameEncoder enc(MSG14001_START_ID, MSG14001_MID_ID, MSG14001_END_ID, false, collectFrame, &out);
+  enc.write(header, sizeof(header));
+  enc.writeXor(payload, len, key);
+  enc.finish();
+  return out;
+}
+
+static std::vector<Frame> encodeRequest(const Request &r) {
+  return encodeMessage(r.type, r.tracker, r.key, r.payload, r.len);
+}
+
+static Request makeRequest(uint8_t type, uint16_t tracker, uint16_t len) {
+  Request r = {type, tracker, (uint8_t)rand(), {}, len};
+  for (uint16_t i = 0; i < len; i++) r.payload[i] = (uint8_t)rand();
+  return r;
+}
+
+// ===== replay =====
+
+// A replayed stream plus the requests it must produce, in completion order
+struct Stream {
+  const char *name;
+  std::vector<Frame> frames;
+  std::vector<const Request *> expect;
+  size_t bytes;
+};
+
+static void appendFrames(Stream &s, const std::vector<Frame> &f, size_t from, size_t to) {
+  for (size_t i = from; i < to; i++) { s.frames.push_back(f[i]); s.bytes += f[i].len; }
+}
+
+static int benchReplay(int, char **) {
+  srand(2);
+  // C4 heartbeat (69 B), DE query (4 B), CB limit write (1 B)
+  const Request c4 = makeRequest(0xC4, 0x0302, 69);
+  const Request de = makeRequest(0xDE, 0x0105, 4);
+  const Request cb = makeRequest(0xCB, 0x2031, 1);
+  const std::vector<Frame> fc4 = encodeRequest(c4), fde = encodeRequest(de), fcb = encodeRequest(cb);
+
+  Stream seq = {"sequential", {}, {}, 0};
+  appendFrames(seq, fc4, 0, fc4.size()); seq.expect.push_back(&c4);
+  appendFrames(seq, fde, 0, fde.size()); seq.expect.push_back(&de);
+  appendFrames(seq, fcb, 0, fcb.size()); seq.expect.push_back(&cb);
+
+  // A DE query starting inside a C4 heartbeat
+  Stream two = {"interleaved x2", {}, {}, 0};
+  appendFrames(two, fc4, 0, 3);
+  appendFrames(two, fde, 0, fde.size()); two.expect.push_back(&de);
+  appendFrames(two, fc4, 3, fc4.size()); two.expect.push_back(&c4);
+  appendFrames(two, fcb, 0, fcb.size()); two.expect.push_back(&cb);
+
+  // Three deep: a CB write inside a DE query inside a C4 heartbeat
+  Stream three = {"interleaved x3", {}, {}, 0};
+  appendFrames(three, fc4, 0, 4);
+  appendFrames(three, fde, 0, 1);
+  appendFrames(three, fcb, 0, fcb.size()); three.expect.push_back(&cb);
+  appendFrames(three, fde, 1, fde.size()); three.expect.push_back(&de);
+  appendFrames(three, fc4, 4, fc4.size()); three.expect.push_back(&c4);
+
+  const unsigned kReplays = 200000;
+  printf("replay of %u passes per stream, %d reassembly slots\n", kReplays, MSG14001_SLOTS);
+  printf("  %-16s %7s %12s %12s %10s\n", "stream", "frames", "Mframes/s", "MB/s", "ns/msg");
+  for (Stream *st : {&seq, &two, &three}) {
+    static Reassembler14001 r;
+    r = Reassembler14001();
+    uint32_t now = 0;
+    size_t got = 0;
+
+    // Verification pass: every message completes, in order, with the
+    // payload decoded back to what was sent
+    for (const Frame &f : st->frames) {
+      const Msg14001 *m = r.feed(f.id, f.data, f.len, now);
+      if (!m) continue;
+      const Request *want = got < st->expect.size() ? st->expect[got] : nullptr;
+      if (!want || m->buf[IDX_TYPE] != want->type || m->payloadLen != want->len ||
+          memcmp(m->buf + MSG14001_HDR_LEN, want->payload, want->len) != 0) {
+        fprintf(stderr, "replay: %s: message %zu wrong\n", st->name, got);
+        return 1;
+      }
+      got++;
+    }
+    if (got != st->expect.size() || r.stats().evicted || r.stats().crcErrors) {
+      fprintf(stderr, "replay: %s: %zu of %zu messages (evicted %u, crc errors %u)\n", st->name, got,
+              st->expect.size(), (unsigned)r.stats().evicted, (unsigned)r.stats().crcErrors);
+      return 1;
+    }
+
+    uint32_t done = 0;
+    const uint64_t t0 = wallNs();
+    for (unsigned p = 0; p < kReplays; p++, now++)
+      for (const Frame &f : st->frames) done += r.feed(f.id, f.data, f.len, now) ? 1 : 0;
+    const uint64_t dt = wallNs() - t0;
+    g_sink = done;
+    if (done != kReplays * st->expect.size()) {
+      fprintf(stderr, "replay: %s: %u of %zu messages in the timed run\n", st->name, (unsigned)done,
+              kReplays * st->expect.size());
+      return 1;
+    }
+    const double frames = (double)kReplays * st->frames.size();
+    printf("  %-16s %7zu %12.2f %12.1f %10.1f\n", st->name, st->frames.size(), frames * 1e3 / dt,
+           (double)kReplays * st->bytes * 1e3 / dt, (double)dt / done);
+  }
+  printf("PASS\n");
+  return 0;
+}
+
+// ===== verify =====
+
+// Reassembly as it was before the CRC check: frames are copied into one
+// buffer and, at the end frame, the payload is XOR-decoded into a second.
+struct CopyReassembler {
+  uint8_t buf[MSG14001_BUF_CAP];
+  uint8_t decoded[MSG14001_MAX_PAYLOAD];
+  size_t  len;
+  bool    active;
+
+  const uint8_t *feed(uint32_t id, const uint8_t *data, uint8_t n, bool decode) {
+    if (id == MSG14001_START_ID) { active = true; len = 0; }
+    if (!active || len + n > sizeof(buf)) { active = false; return nullptr; }
+    memcpy(buf + len, data, n);
+    len += n;
+    if (id != MSG14001_END_ID) return nullptr;
+    active = false;
+    const size_t payload = buf[IDX_LEN_LO] | (buf[IDX_LEN_HI] << 8);
+    if (len != MSG14001_HDR_LEN + payload + 2) return nullptr;
+    if (!decode) return buf;
+    const uint8_t key = buf[IDX_XOR];
+    for (size_t i = 0; i < payload; i++) decoded[i] = buf[MSG14001_HDR_LEN + i] ^ key;
+    return decoded;
+  }
+};
+
+// Swaps the two CRC bytes at the end of a frame stream (they may straddle frames)
+static void swapCrcBytes(std::vector<Frame> &frames) {
+  uint8_t *b[2] = {nullptr, nullptr};
+  int k = 1;
+  for (size_t i = frames.size(); i-- > 0 && k >= 0;)
+    for (size_t j = frames[i].len; j-- > 0 && k >= 0;) b[k--] = &frames[i].data[j];
+  std::swap(*b[0], *b[1]);
+}
+
+static size_t streamBytes(const std::vector<Frame> &frames) {
+  size_t n = 0;
+  for (const Frame &f : frames) n += f.len;
+  return n;
+}
+
+static int benchVerify(int, char **) {
+  srand(4);
+  static uint8_t payload[MSG14001_MAX_PAYLOAD];
+  for (size_t i = 0; i < sizeof(payload); i++) payload[i] = (uint8_t)rand();
+
+  // CB write, C4 heartbeat, a long 13-sized message and close to the maximum
+  static const uint16_t kLens[] = {1, 69, 600, 2000};
+  static Reassembler14001 r;
+  static CopyReassembler copy;
+  uint32_t now = 0;
+
+  // Correctness: every size decodes back to what was sent on both paths; a
+  // BE CRC is accepted and counted, a corrupted message is rejected.
+  for (uint16_t len : kLens) {
+    const uint8_t key = (uint8_t)rand();
+    const std::vector<Frame> frames = encodeMessage(0x13, 0x0101, key, payload, len);
+    r = Reassembler14001();
+    const Msg14001 *m = nullptr;
+    const uint8_t *c = nullptr;
+    for (const Frame &f : frames) {
+      if (const Msg14001 *got = r.feed(f.id, f.data, f.len, now)) m = got;
+      if (const uint8_t *got = copy.feed(f.id, f.data, f.len, true)) c = got;
+    }
+    if (!m || m->payloadLen != len || memcmp(m->buf + MSG14001_HDR_LEN, payload, len) != 0 ||
+        !c || memcmp(c, payload, len) != 0) {
+      fprintf(stderr, "verify: %u byte message not decoded\n", (unsigned)len);
+      return 1;
+    }
+
+    std::vector<Frame> swapped = frames, corrupt = frames;
+    swapCrcBytes(swapped);
+    corrupt[2].data[2] ^= 0x40;   // first payload byte
+    bool gotSwapped = false, gotCorrupt = false;
+    for (const Frame &f : swapped) gotSwapped |= r.feed(f.id, f.data, f.len, now) != nullptr;
+    for (const Frame &f : corrupt) gotCorrupt |= r.feed(f.id, f.data, f.len, now) != nullptr;
+    const bool rejects = MSG14001_VERIFY_CRC;
+    if (!gotSwapped || r.stats().crcSwapped != 1 || gotCorrupt == rejects || r.stats().crcErrors != 1) {
+      fprintf(stderr, "verify: %u bytes: BE CRC %s (swapped %u), corrupt %s (crc errors %u)\n",
+              (unsigned)len, gotSwapped ? "accepted" : "rejected", (unsigned)r.stats().crcSwapped,
+              gotCorrupt ? "accepted" : "rejected", (unsigned)r.stats().crcErrors);
+      return 1;
+    }
+  }
+
+  // Throughput: best of 5 alternating rounds, 32 MiB of frame data each
+  const size_t kBytes = 32u << 20;
+  printf("verify: frame bytes in, best of 5 rounds\n");
+  printf("  %6s %12s %12s %14s %8s\n", "len", "copy MB/s", "+decode MB/s", "verify MB/s", "vs +dec");
+  for (uint16_t len : kLens) {
+    const std::vector<Frame> frames = encodeMessage(0x13, 0x0101, 0x5A, payload, len);
+    const size_t bytes = streamBytes(frames);
+    const size_t passes = kBytes / bytes;
+    r = Reassembler14001();
+    uint64_t best[3] = {UINT64_MAX, UINT64_MAX, UINT64_MAX};
+    for (int round = 0; round < 5; round++) {
+      for (int path = 0; path < 3; path++) {
+        uint32_t done = 0;
+        const uint64_t t0 = wallNs();
+        for (size_t p = 0; p < passes; p++, now++)
+          for (const Frame &f : frames)
+            done += (path == 2 ? (const void *)r.feed(f.id, f.data, f.len, now)
+                               : (const void *)copy.feed(f.id, f.data, f.len, path == 1)) ? 1 : 0;
+        best[path] = std::min(best[path], wallNs() - t0);
+        g_sink = done;
+        if (done != passes) {
+          fprintf(stderr, "verify: %u bytes: %u of %zu messages\n", (unsigned)len, (unsigned)done, passes);
+          return 1;
+        }
+      }
+    }
+    const double mb = (double)passes * bytes * 1e3;
+    printf("  %6u %12.1f %12.1f %14.1f %7.2fx\n", (unsigned)len, mb / best[0], mb / best[1], mb / best[2],
+           (double)best[1] / best[2]);
+  }
+  printf("PASS\n");
+  return 0;
+}
+
+// ===== Bridges =====
+
+// A bridge with its own bindings and every message enabled
+struct BenchLink {
+  EcoflowConfig cfg;
+  float inW, outW;
+  BridgeContext ctx;
+};
+
+static BenchLink *newLink(BridgeSendFn send, void *arg) {
+  BenchLink *l = new BenchLink();
+  EcoflowConfig &cfg = l->cfg;
+  cfg.volt = 5120; cfg.soc = 75; cfg.temp = 25; cfg.chgvolt = 5600;
+  cfg.message70 = cfg.message0B = cfg.message4F = cfg.message68 = cfg.message13 = true;
+  cfg.messageCB = cfg.message5C = cfg.message24 = cfg.message8C = cfg.message3C = true;
+  cfg.canTxEnabled = true;
+  bridgeInit(l->ctx, &cfg, &bms, &l->inW, &l->outW, send, arg);
+  return l;
+}
+
+static void countFrame(void *arg, uint32_t, const uint8_t *, uint8_t) {
+  (*static_cast<uint64_t *>(arg))++;
+}
+
+static uint64_t threadCpuNs() {
+  timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// ===== txgap =====
+
+#ifdef EF_PS_TX_TASK
+
+static uint32_t kSeqCycleMs() {
+  uint32_t ms = 0;
+  for (const Step &st : kSeq) ms += st.gap_ms;
+  return ms;
+}
+
+// First frame of every sequencer message, stamped by the TX thread
+struct TxStart { uint64_t us; uint8_t type; };
+
+struct TxLog {
+  TxStart  rec[8192];
+  uint32_t n;
+};
+
+static void logTxStart(void *arg, uint32_t id, const uint8_t *data, uint8_t len) {
+  TxLog &log = *static_cast<TxLog *>(arg);
+  if ((id & 0x1FFFFFFF) != 0x10003001UL || log.n == sizeof(log.rec) / sizeof(log.rec[0])) return;
+  const bool prefixed = len >= 2 && data[0] == len - 1 && data[1] == 0xAA;
+  log.rec[log.n++] = {wallNs() / 1000, data[prefixed ? 5 : 4]};
+}
+
+static int benchTxGap(int argc, char **argv) {
+  const unsigned cycles = (argc > 1) ? (unsigned)atoi(argv[1]) : 10;
+  const uint8_t steps = sizeof(kSeq) / sizeof(kSeq[0]);
+  const uint32_t cycleMs = kSeqCycleMs();
+  static TxLog log;
+  BenchLink *link = newLink(logTxStart, &log);
+  BridgeContext *ctx = &link->ctx;
+
+  // The heartbeat starts the sequencer and keeps it running; it is called
+  // directly so no replies mix into the schedule.
+  canSequencer_onHeartbeatC4(*ctx);
+  if (!txTaskStart()) { fprintf(stderr, "txgap: no TX task on this platform\n"); return 1; }
+  const uint64_t end = wallNs() / 1000 + (uint64_t)cycles * cycleMs * 1000u + 50000u;
+  while (wallNs() / 1000 < end) {
+    usleep(200000);
+    // As loop() does: change the inputs, then drain, which hands them over
+    link->cfg.soc = (link->cfg.soc == 75) ? 76 : 75;
+    link->inW += 1.0f;
+    canRxDrain(*ctx, EF_RX_QUEUE_LEN);
+    canSequencer_onHeartbeatC4(*ctx);
+  }
+  txTaskStop();
+
+  // Every step sends exactly one message with all messages enabled, so
+  // message i is kSeq[i % steps] and is due at the sum of the gaps before it
+  const uint32_t n = std::min<uint32_t>(log.n, cycles * steps);
+  if (n < (uint32_t)cycles * steps) {
+    fprintf(stderr, "txgap: %u messages, expected %u\n", (unsigned)log.n, cycles * steps);
+    return 1;
+  }
+  std::vector<int64_t> gapErr, driftUs;
+  uint64_t due = log.rec[0].us;
+  for (uint32_t i = 1; i < n; i++) {
+    const Step &prev = kSeq[(i - 1) % steps];
+    due += prev.gap_ms * 1000u;
+    const int64_t gap = (int64_t)(log.rec[i].us - log.rec[i - 1].us);
+    gapErr.push_back(gap - (int64_t)prev.gap_ms * 1000);
+    driftUs.push_back((int64_t)(log.rec[i].us - due));
+  }
+  auto pct = [](std::vector<int64_t> v, int p) {
+    for (int64_t &x : v) x = x < 0 ? -x : x;
+    std::sort(v.begin(), v.end());
+    return v[(v.size() - 1) * p / 100];
+  };
+  const SeqStats &st = sequencerStats(*ctx);
+  printf("txgap: %u cycles of %u steps (%u ms), %u messages\n", cycles, (unsigned)steps,
+         (unsigned)cycleMs, (unsigned)n);
+  printf("  |gap - kSeq gap|     p50 %6lld us  p99 %6lld us  max %6lld us\n",
+         (long long)pct(gapErr, 50), (long long)pct(gapErr, 99), (long long)pct(gapErr, 100));
+  printf("  |start - deadline|   p50 %6lld us  p99 %6lld us  max %6lld us\n",
+         (long long)pct(driftUs, 50), (long long)pct(driftUs, 99), (long long)pct(driftUs, 100));
+  printf("  sequencer: %u cycles, last %u ms, resyncs %u\n", (unsigned)st.cycle.count,
+         (unsigned)st.cycle.lastMs, (unsigned)st.resyncs);
+
+  // Deadlines are absolute, so lateness must not build up over the run.
+  // The bound is loose enough for a shared CI runner.
+  const int64_t kMaxDriftUs = 20000;
+  if (st.resyncs || pct(driftUs, 99) > kMaxDriftUs) {
+    printf("FAIL\n");
+    return 1;
+  }
+  printf("PASS\n");
+  return 0;
+}
+
+#else
+
+static int benchTxGap(int, char **) {
+  fprintf(stderr, "txgap: build with -DEF_PS_TX_TASK\n");
+  return 2;
+}
+
+#endif
+
+// ===== cycle =====
+
+// canFrameBits as first written: SOF .. CRC fed one bit at a time
+static uint16_t canFrameBitsReference(uint32_t id, bool extended, const uint8_t *data, uint8_t dlc) {
+  uint16_t bits = 0, stuffed = 0, crc = 0;
+  uint8_t run = 0, last = 2;
+  auto bit = [&](uint8_t b, bool inCrc) {
+    if (!inCrc) {
+      const uint8_t nxt = b ^ ((crc >> 14) & 1);
+      crc = (uint16_t)((crc << 1) & 0x7FFF);
+      if (nxt) crc ^= 0x4599;
+    }
+    bits++;
+    if (b == last) {
+      if (++run == 5) { stuffed++; last = b ^ 1; run = 1; }
+    } else {
+      last = b;
+      run = 1;
+    }
+  };
+  auto field = [&](uint32_t v, uint8_t n) { while (n--) bit((uint8_t)((v >> n) & 1), false); };
+
+  bit(0, false);
+  if (extended) {
+    field((id >> 18) & 0x7FF, 11);
+    bit(1, false);
+    bit(1, false);
+    field(id & 0x3FFFF, 18);
+    field(0, 3);
+  } else {
+    field(id & 0x7FF, 11);
+    field(0, 3);
+  }
+  field(dlc, 4);
+  for (uint8_t i = 0; i < dlc; i++) field(data[i], 8);
+  const uint16_t c = crc;
+  for (int8_t i = 14; i >= 0; i--) bit((uint8_t)((c >> i) & 1), true);
+  return (uint16_t)(bits + stuffed + 13);
+}
+
+// canFrameBits against the reference on random and stuffing-heavy frames
+static bool checkFrameBits() {
+  srand(5);
+  for (unsigned i = 0; i < 200000; i++) {
+    uint8_t data[8];
+    const uint8_t fill = (i & 1) ? 0xFF : 0x00;
+    for (uint8_t &b : data) b = (i % 3) ? (uint8_t)rand() : fill;
+    const uint32_t id = (i % 5) ? (uint32_t)rand() & 0x1FFFFFFF : ((i & 2) ? 0x1FFFFFFF : 0);
+    const bool ext = (i % 7) != 0;
+    const uint8_t dlc = (uint8_t)(i % 9);
+    const uint16_t got = canFrameBits(id, ext, data, dlc), want = canFrameBitsReference(id, ext, data, dlc);
+    if (got != want) {
+      fprintf(stderr, "cycle: canFrameBits(%08X, %s, dlc %u) = %u, reference %u\n", (unsigned)id,
+              ext ? "ext" : "std", dlc, got, want);
+      return false;
+    }
+  }
+  return true;
+}
+
+// Run `cycles` kSeq cycles on virtual time and return the CPU time spent in
+// the sequencer
+static uint64_t runCycles(BenchLink &l, VirtualClock &vc, unsigned cycles) {
+  const uint8_t steps = sizeof(kSeq) / sizeof(kSeq[0]);
+  const uint64_t t0 = threadCpuNs();
+  for (unsigned c = 0; c < cycles; c++) {
+    canSequencer_onHeartbeatC4(l.ctx);
+    for (uint8_t i = 0; i < steps; i++) {
+      vc.advanceTo((uint64_t)l.ctx.nextDueMs * 1000u);
+      canTxSequencerTick(l.ctx);
+    }
+  }
+  return threadCpuNs() - t0;
+}
+
+static int benchCycle(int argc, char **argv) {
+  const unsigned cycles = (argc > 1) ? (unsigned)atoi(argv[1]) : 20000;
+  const unsigned kRounds = 5;
+  VirtualClock vc;
+  vc.install(1000000);
+
+  uint64_t frames = 0;
+  BenchLink *link = newLink(countFrame, &frames);
+  runCycles(*link, vc, 100);   // warm up
+  frames = 0;
+
+  // Best of several rounds, so frequency changes and other load drop out
+  uint64_t best = UINT64_MAX;
+  for (unsigned r = 0; r < kRounds; r++) best = std::min(best, runCycles(*link, vc, cycles / kRounds));
+
+  // Frames of one cycle, to cost the bus-load meter's share separately
+  std::vector<Frame> one;
+  BenchLink *rec = newLink(collectFrame, &one);
+  runCycles(*rec, vc, 1);
+  vc.uninstall();
+  uint32_t bits = 0;
+  uint64_t t0 = threadCpuNs();
+  for (unsigned i = 0; i < 1000; i++)
+    for (const Frame &f : one) bits += canFrameBits(f.id, true, f.data, f.len);
+  const double meterNs = (threadCpuNs() - t0) / 1000.0;
+  t0 = threadCpuNs();
+  for (unsigned i = 0; i < 1000; i++)
+    for (const Frame &f : one) bits += canFrameBitsReference(f.id, true, f.data, f.len);
+  const double meterRefNs = (threadCpuNs() - t0) / 1000.0;
+  g_sink = bits;
+
+  const double per = cycles / kRounds;
+  printf("cycle: %u kSeq cycles of %u steps, %zu frames per cycle\n", cycles,
+         (unsigned)(sizeof(kSeq) / sizeof(kSeq[0])), one.size());
+  printf("  sequencer CPU                                 %8.2f us/cycle\n", best / 1e3 / per);
+  printf("  of which bus-load bit costing                 %8.2f us/cycle\n", meterNs / 1e3);
+  printf("  bit costing, bit-serial reference             %8.2f us/cycle\n", meterRefNs / 1e3);
+  if (!frames || frames != (uint64_t)one.size() * per * kRounds) {
+    fprintf(stderr, "cycle: %llu frames, expected %zu per cycle\n", (unsigned long long)frames, one.size());
+    return 1;
+  }
+  if (!checkFrameBits()) return 1;
+  printf("PASS\n");
+  return 0;
+}
+
+// ===== spsc =====
+
+static void sleepUntilNs(uint64_t ns) {
+  timespec t = {(time_t)(ns / 1000000000ull), (long)(ns % 1000000000ull)};
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &t, nullptr) == EINTR) {}
+}
+
+static int benchSpsc(int argc, char **argv) {
+  const unsigned seconds = (argc > 1) ? (unsigned)atoi(argv[1]) : 5;
+
+  // 1) The ring itself: a free-running producer against a free-running
+  //    consumer, every item must arrive once and in order
+  {
+    static SpscQueue<uint32_t, EF_RX_QUEUE_LEN> q;
+    const uint32_t kItems = 20000000;
+    std::atomic<bool> bad{false};
+    const uint64_t t0 = wallNs();
+    // yield when blocked so a single-CPU runner still makes progress
+    std::thread prod([&] {
+      for (uint32_t i = 0; i < kItems;)
+        if (q.push(i)) i++;
+        else std::this_thread::yield();
+    });
+    uint32_t v, next = 0;
+    while (next < kItems) {
+      if (q.pop(v)) { if (v != next) bad = true; next++; }
+      else std::this_thread::yield();
+    }
+    prod.join();
+    const uint64_t dt = wallNs() - t0;
+    printf("spsc: ring %u items in %.1f ms, %.1f M items/s%s\n", (unsigned)kItems, dt / 1e6,
+           kItems * 1e3 / dt, bad ? ", OUT OF ORDER" : "");
+    if (bad) return 1;
+  }
+
+  // 2) The bridge RX path: a thread standing in for the canbus callback
+  //    enqueues C4/DE request frames back to back at 1 Mbit/s, the main
+  //    thread drains every millisecond like a busy loop()
+  uint64_t txFrames = 0;
+  BenchLink *l = newLink(countFrame, &txFrames);
+  srand(3);
+  const Request c4 = makeRequest(0xC4, 0x0302, 69);
+  const Request de = makeRequest(0xDE, 0x0105, 4);
+  std::vector<Frame> pattern;
+  for (const Request *r : {&c4, &de, &de}) {
+    const std::vector<Frame> f = encodeRequest(*r);
+    pattern.insert(pattern.end(), f.begin(), f.end());
+  }
+  const uint32_t msgsPerPattern = 3;
+
+  const uint32_t bitrate = 1000000;
+  std::atomic<bool> done{false};
+  std::atomic<uint32_t> patternsSent{0};
+  uint64_t framesSent = 0, bitsSent = 0;
+  const uint32_t drops0 = l->ctx.metrics.get(MET_RX_QUEUE_DROPS);
+  const uint64_t start = wallNs();
+  std::thread prod([&] {
+    const uint64_t end = start + (uint64_t)seconds * 1000000000ull;
+    for (;;) {
+      for (const Frame &f : pattern) {
+        ef_twai_message_t rx = {};
+        rx.identifier = f.id;
+        rx.extd = true;
+        rx.data_length_code = f.len;
+        memcpy(rx.data, f.data, f.len);
+        // frame i may go out once the bus has carried frames 0..i-1
+        const uint64_t due = start + bitsSent * 1000000000ull / bitrate;
+        if (due > wallNs() + 200000) sleepUntilNs(due);
+        canRxEnqueue(l->ctx, rx);
+        bitsSent += canFrameBits(f.id, true, f.data, f.len);
+        framesSent++;
+      }
+      patternsSent++;
+      if (wallNs() >= end) break;
+    }
+    done = true;
+  });
+
+  size_t maxDepth = 0;
+  while (!done.load()) {
+    maxDepth = std::max(maxDepth, l->ctx.rxQueue.size());
+    canRxDrain(l->ctx, EF_RX_QUEUE_LEN);
+    usleep(1000);
+  }
+  prod.join();
+  while (canRxDrain(l->ctx, EF_RX_QUEUE_LEN)) {}
+  const double secs = (wallNs() - start) / 1e9;
+
+  const uint32_t drops = l->ctx.metrics.get(MET_RX_QUEUE_DROPS) - drops0;
+  const Reassembler14001Stats &rs = rx14001Stats(l->ctx);
+  const uint32_t msgs = patternsSent.load() * msgsPerPattern;
+  printf("spsc: %llu frames in %.2f s, %.0f frames/s, %.1f%% of %u bit/s\n",
+         (unsigned long long)framesSent, secs, framesSent / secs, bitsSent * 100.0 / (secs * bitrate),
+         (unsigned)bitrate);
+  printf("  queue: depth max %zu of %u, drops %u\n", maxDepth, (unsigned)EF_RX_QUEUE_LEN, (unsigned)drops);
+  printf("  reassembled %u of %u messages (crc errors %u, dropped %u), %llu reply frames\n",
+         (unsigned)rs.completed, (unsigned)msgs, (unsigned)rs.crcErrors,
+         (unsigned)(rs.evicted + rs.timedOut + rs.truncated), (unsigned long long)txFrames);
+  if (drops || rs.completed != msgs || rs.crcErrors) {
+    printf("FAIL\n");
+    return 1;
+  }
+  printf("PASS\n");
+  return 0;
+}
+
+// ===== ctx =====
+
+// Each context gets a C4 heartbeat through its RX queue every cycle and
+// runs its own kSeq; all of them are ticked at the shared deadlines.
+static uint64_t runContexts(std::vector<BenchLink *> &links, VirtualClock &vc,
+                            const std::vector<Frame> &c4, unsigned cycles) {
+  const uint8_t steps = sizeof(kSeq) / sizeof(kSeq[0]);
+  const uint64_t t0 = threadCpuNs();
+  for (unsigned c = 0; c < cycles; c++) {
+    for (BenchLink *l : links) {
+      for (const Frame &f : c4) {
+        ef_twai_message_t rx = {};
+        rx.identifier = f.id;
+        rx.extd = true;
+        rx.data_length_code = f.len;
+        memcpy(rx.data, f.data, f.len);
+        canRxEnqueue(l->ctx, rx);
+      }
+      canRxDrain(l->ctx, EF_RX_QUEUE_LEN);
+    }
+    for (uint8_t i = 0; i < steps; i++) {
+      vc.advanceTo((uint64_t)links[0]->ctx.nextDueMs * 1000u);
+      for (BenchLink *l : links) canTxSequencerTick(l->ctx);
+    }
+  }
+  return threadCpuNs() - t0;
+}
+
+static int benchCtx(int argc, char **argv) {
+  const unsigned cycles = (argc > 1) ? (unsigned)atoi(argv[1]) : 2000;
+  static const unsigned kCounts[] = {1, 2, 4, 8, 16, 32};
+  VirtualClock vc;
+  vc.install(1000000);
+  srand(4);
+  uint8_t serial[69] = {0};
+  memcpy(serial + 3, "HW51ZEH4SF000001", 16);
+  Request c4 = {0xC4, 0x0302, 0x5A, {}, sizeof(serial)};
+  memcpy(c4.payload, serial, sizeof(serial));
+  const std::vector<Frame> fc4 = encodeRequest(c4);
+
+  printf("ctx: %u kSeq cycles per run, one C4 per context per cycle, %zu bytes per BridgeContext\n",
+         cycles, sizeof(BridgeContext));
+  printf("  %8s %14s %18s\n", "contexts", "us/cycle", "us/cycle/context");
+  double base = 0, last = 0;
+  for (unsigned n : kCounts) {
+    std::vector<uint64_t> frames(n, 0);
+    std::vector<BenchLink *> links;
+    for (unsigned i = 0; i < n; i++) links.push_back(newLink(countFrame, &frames[i]));
+    runContexts(links, vc, fc4, 20);   // warm up: first prepares, sequencers running
+    for (uint64_t &f : frames) f = 0;
+
+    const uint64_t cpu = runContexts(links, vc, fc4, cycles);
+    const double perCtx = cpu / 1e3 / cycles / n;
+    if (n == 1) base = perCtx;
+    last = perCtx;
+    printf("  %8u %14.2f %18.2f\n", n, cpu / 1e3 / cycles, perCtx);
+
+    // Contexts are independent: each sent its own kSeq plus its own replies
+    for (unsigned i = 0; i < n; i++) {
+      const TxReplyStats &rs = txReplyStats(links[i]->ctx, TX_REPLY_3C);
+      if (frames[i] != frames[0] || !frames[i] || rs.dropped) {
+        fprintf(stderr, "ctx: context %u of %u sent %llu frames (first sent %llu), %u replies dropped\n",
+                i, n, (unsigned long long)frames[i], (unsigned long long)frames[0], (unsigned)rs.dropped);
+        return 1;
+      }
+    }
+  }
+  vc.uninstall();
+  printf("  per-context cost at %u contexts: %.2fx that of one\n",
+         kCounts[sizeof(kCounts) / sizeof(kCounts[0]) - 1], base > 0 ? last / base : 0.0);
+  printf("PASS\n");
+  return 0;
+}
+
+// ===== Modes =====
+
+struct Mode {
+  const char *name;
+  int (*run)(int argc, char **argv);
+  const char *help;
+};
+
+static const Mode kModes[] = {
+  {"crc",    benchCrc,    "CRC16 engine vs the original per-byte table loop"},
+  {"replay", benchReplay, "14001 reassembly of sequential and interleaved streams"},
+  {"verify", benchVerify, "reassembly with CRC check and decode vs plain copy"},
+  {"txgap",  benchTxGap,  "gaps between TX task messages vs kSeq [cycles]"},
+  {"cycle",  benchCycle,  "CPU time per kSeq cycle and bit costing share [cycles]"},
+  {"spsc",   benchSpsc,   "RX queue with a producer thread at 1 Mbit/s [seconds]"},
+  {"ctx",    benchCtx,    "CPU per BridgeContext for 1..32 contexts [cycles]"},
+};
+
+static void usage(const char *argv0) {
+  fprintf(stderr, "usage: %s MODE [args]\n", argv0);
+  for (const Mode &m : kModes) fprintf(stderr, "  %-8s %s\n", m.name, m.help);
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) { usage(argv[0]); return 2; }
+  for (const Mode &m : kModes)
+    if (strcmp(argv[1], m.name) == 0) return m.run(argc - 1, argv + 1);
+  usage(argv[0]);
+  return 2;
+}
@@ -0,0 +1,205 @@
+// EcoFlow PowerStream bridge as a Linux daemon over SocketCAN.
+//
+// One BridgeContext per CAN interface, all driven from a single epoll loop:
+// RX frames are read in batches as soon as a socket is readable, queued
+// replies go out right after the request that caused them, and the kSeq
+// sequencer of every bridge runs off the shortest pending deadline.
+//
+// Build (from the repository root):
+//   g++ -std=gnu++17 -O2 -Icomponents/ef_ps -o ef_ps_daemon tools/ef_ps_daemon.cpp
+//       $(ls components/ef_ps/*.cpp | grep -v ef_ps.cpp) -lpthread
+//
+// Try it without hardware:
+//   sudo ip link add dev vcan0 type vcan && sudo ip link set up vcan0
+//   ./ef_ps_daemon -v 5 vcan0
+
+#include "ecoflow.h"
+#include "bridge_context.h"
+#include "socketcan.h"
+#include "metrics.h"
+#include "clock.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifndef EF_DAEMON_MAX_BUSES
+#define EF_DAEMON_MAX_BUSES 16
+#endif
+#define EF_DAEMON_RX_TICK_MS 16   // reassembly timeouts are checked at least this often
+
+// The ESPHome default bridge is not used here; every bus has its own context
+void sendCANFrame(uint32_t, const uint8_t *, uint8_t) {}
+
+struct Link {
+  SocketCanBus  bus;
+  BridgeContext ctx;
+  EcoflowConfig cfg;
+  float inputWatt;
+  float outputWatt;
+  bool  wantOut;     // EPOLLOUT armed
+};
+
+static volatile sig_atomic_t g_stop = 0;
+static void onSignal(int) { g_stop = 1; }
+
+static void usage(const char *argv0) {
+  fprintf(stderr,
+          "usage: %s [-b bitrate] [-V volt] [-s soc] [-t temp] [-S serial] [-v secs] IFACE [IFACE...]\n"
+          "  -b  bus bit rate for load figures (default 1000000)\n"
+          "  -V  battery voltage, 0.01 V units (default 5120)\n"
+          "  -s  state of charge %% (default 75)\n"
+          "  -t  temperature C (default 25)\n"
+          "  -S  16-character battery serial\n"
+          "  -v  print statistics every N seconds\n",
+          argv0);
+}
+
+static void armOut(int ep, Link &l, int idx, bool want) {
+  if (l.wantOut == want) return;
+  epoll_event ev = {};
+  ev.events = want ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+  ev.data.u32 = (uint32_t)idx;
+  epoll_ctl(ep, EPOLL_CTL_MOD, l.bus.fd(), &ev);
+  l.wantOut = want;
+}
+
+// Counter summed over all links
+static unsigned total(const Link *links, int n, MetricId id) {
+  uint32_t v = 0;
+  for (int i = 0; i < n; i++) v += links[i].ctx.metrics.get(id);
+  return (unsigned)v;
+}
+
+static void printStats(const Link *links, int n) {
+  printf("rx %u frames / %u msgs, tx %u frames / %u msgs, drops rx %u reasm %u reply %u\n",
+         total(links, n, MET_RX_FRAMES), total(links, n, MET_RX_MESSAGES),
+         total(links, n, MET_TX_FRAMES), total(links, n, MET_TX_MESSAGES),
+         total(links, n, MET_RX_QUEUE_DROPS), total(links, n, MET_RX_REASM_DROPS),
+         total(links, n, MET_TX_REPLY_DROPS));
+  for (int i = 0; i < n; i++) {
+    const Link &l = links[i];
+    const SocketCanStats &s = l.bus.stats();
+    BusLoadStats bl;
+    canBusLoad(const_cast<BridgeContext &>(l.ctx), bl);
+    printf("  %-8s peer %-16s %s  load %.1f%% (peak %.1f%%)  rx %u/%u calls  tx %u/%u calls, %u retries, %u dropped\n",
+           l.bus.name(), getPeerSerial(l.ctx)[0] ? getPeerSerial(l.ctx) : "-",
+           l.ctx.canHealth ? "up  " : "down", bl.loadPct, bl.peak100Pct,
+           (unsigned)s.rxFrames, (unsigned)s.rxCalls, (unsigned)s.txFrames, (unsigned)s.txCalls,
+           (unsigned)s.txRetries, (unsigned)s.txDropped);
+  }
+  fflush(stdout);
+}
+
+int main(int argc, char **argv) {
+  uint32_t bitrate = EF_CAN_BITRATE;
+  int volt = 5120, soc = 75, temp = 25, statsSec = 0;
+  const char *serial = nullptr;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "b:V:s:t:S:v:h")) != -1) {
+    switch (opt) {
+      case 'b': bitrate = (uint32_t)strtoul(optarg, nullptr, 0); break;
+      case 'V': volt = atoi(optarg); break;
+      case 's': soc = atoi(optarg); break;
+      case 't': temp = atoi(optarg); break;
+      case 'S': serial = optarg; break;
+      case 'v': statsSec = atoi(optarg); break;
+      default: usage(argv[0]); return 2;
+    }
+  }
+  const int nLinks = argc - optind;
+  if (nLinks < 1 || nLinks > EF_DAEMON_MAX_BUSES) { usage(argv[0]); return 2; }
+
+  srand((unsigned)time(nullptr));
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+  signal(SIGPIPE, SIG_IGN);
+
+  const int ep = epoll_create1(EPOLL_CLOEXEC);
+  if (ep < 0) { perror("epoll_create1"); return 1; }
+
+  // Contexts carry the reassembly slabs: keep them off the stack
+  Link *links = new Link[nLinks]();
+  bool ready = true;   // false: setup failed, skip straight to cleanup
+  for (int i = 0; i < nLinks && ready; i++) {
+    Link &l = links[i];
+    const char *ifname = argv[optind + i];
+    if (!l.bus.open(ifname)) {
+      fprintf(stderr, "%s: %s\n", ifname, strerror(errno));
+      ready = false;
+      break;
+    }
+
+    EcoflowConfig &c = l.cfg;
+    c.volt = volt; c.soc = soc; c.temp = temp;
+    if (serial) strncpy(c.serialStr, serial, sizeof(c.serialStr));
+    c.message70 = c.message0B = c.message4F = c.message68 = c.message13 = true;
+    c.messageCB = c.message5C = c.message24 = c.message8C = c.message3C = true;
+    c.canTxEnabled = true;
+
+    bridgeInit(l.ctx, &l.cfg, &bms, &l.inputWatt, &l.outputWatt, &SocketCanBus::send, &l.bus);
+    l.ctx.busLoad.setBitrate(bitrate);
+
+    epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.u32 = (uint32_t)i;
+    if (epoll_ctl(ep, EPOLL_CTL_ADD, l.bus.fd(), &ev) < 0) { perror("epoll_ctl"); ready = false; }
+  }
+
+  uint32_t lastRxTick = clockMillis();
+  uint32_t lastStats = lastRxTick;
+  epoll_event events[EF_DAEMON_MAX_BUSES];
+  int rc = ready ? 0 : 1;
+
+  while (ready && !g_stop) {
+    // Sequencer steps (and any replies still queued) on every bridge
+    uint32_t wait = bridgeTickAll();
+
+    const uint32_t now = clockMillis();
+    if (now - lastRxTick >= EF_DAEMON_RX_TICK_MS) {
+      for (int i = 0; i < nLinks; i++) canRxTick(links[i].ctx);
+      lastRxTick = now;
+    }
+    if (statsSec > 0 && now - lastStats >= (uint32_t)statsSec * 1000u) {
+      printStats(links, nLinks);
+      lastStats = now;
+    }
+
+    for (int i = 0; i < nLinks; i++) armOut(ep, links[i], i, links[i].bus.flush() != 0);
+
+    if (wait > EF_DAEMON_RX_TICK_MS) wait = EF_DAEMON_RX_TICK_MS;
+    const int n = epoll_wait(ep, events, EF_DAEMON_MAX_BUSES, (int)wait);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      perror("epoll_wait");
+      break;
+    }
+
+    for (int e = 0; e < n; e++) {
+      Link &l = links[events[e].data.u32];
+      if (events[e].events & (EPOLLIN | EPOLLERR | EPOLLHUP)) {
+        if (l.bus.receive(l.ctx) < 0) {
+          // interface gone or down: leave it to the service manager to restart us
+          fprintf(stderr, "%s: %s\n", l.bus.name(), strerror(errno));
+          rc = 1;
+          g_stop = 1;
+          break;
+        }
+        // answer C4/DE/CB now instead of at the next sequencer step
+        txPumpReplies(l.ctx);
+      }
+      if (events[e].events & (EPOLLIN | EPOLLOUT)) l.bus.flush();
+    }
+  }
+
+  if (ready && statsSec > 0) printStats(links, nLinks);
+  delete[] links;
+  close(ep);
+  return rc;
+}
@@ -0,0 +1,197 @@
+// Host test: protocol behaviour of one bridge, request frames in and reply
+// frames out, without timing.
+//
+//   replies   requests of the same kind queued back-to-back (one canRxDrain)
+//             are each answered with their own XOR key and tracker
+//   dispatch  a handler for msg_type T >= 0x80 never runs for T & 0x7F and
+//             the other way round, for exact and RX_TRACKER_ANY handlers
+//
+// Replies are decoded with the bridge's own Reassembler14001 after moving
+// their IDs from the TX (0x10x03001) to the RX (0x10x14001) range.
+//
+// Build (from the repository root); dispatch registers a handler for every
+// msg_type, so the handler table is enlarged:
+//   g++ -std=gnu++17 -O2 -DEF_RX_HANDLERS=1024 -Icomponents/ef_ps -o ef_ps_protocol_test
+//       tools/ef_ps_protocol_test.cpp $(ls components/ef_ps/*.cpp | grep -v ef_ps.cpp) -lpthread
+
+#include "ecoflow.h"
+#include "bridge_context.h"
+#include "frame_encoder.h"
+#include "reassembler.h"
+#include "rx_dispatch.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+// The ESPHome default bridge is not used here
+void sendCANFrame(uint32_t, const uint8_t *, uint8_t) {}
+
+// ===== Bridge under test =====
+
+// A decoded reply: type, tracker and the key it was encoded with
+struct Reply { uint8_t type; uint16_t tracker; uint8_t key; };
+
+struct Rig {
+  EcoflowConfig cfg;
+  float inW, outW;
+  BridgeContext ctx;
+  Reassembler14001 reasm;
+  std::vector<Reply> replies;
+};
+
+static void collectReply(void *arg, uint32_t id, const uint8_t *data, uint8_t len) {
+  Rig &r = *static_cast<Rig *>(arg);
+  // 0x10x03001 → 0x10x14001: same routing byte, RX function code
+  const Msg14001 *m = r.reasm.feed((id & 0xFFF00000UL) | 0x00014001UL, data, len, 0);
+  if (m) r.replies.push_back({m->buf[IDX_TYPE], (uint16_t)((m->buf[IDX_TRK0] << 8) | m->buf[IDX_TRK1]),
+                              m->buf[IDX_XOR]});
+}
+
+static Rig *newRig() {
+  Rig *r = new Rig();
+  EcoflowConfig &c = r->cfg;
+  c.volt = 5120; c.soc = 75; c.temp = 25; c.chgvolt = 5600;
+  c.message70 = c.message0B = c.message4F = c.message68 = c.message13 = true;
+  c.messageCB = c.message5C = c.message24 = c.message8C = c.message3C = true;
+  c.canTxEnabled = true;
+  bridgeInit(r->ctx, &r->cfg, &bms, &r->inW, &r->outW, collectReply, r);
+  return r;
+}
+
+static void enqueueCollect(void *arg, uint32_t id, const uint8_t *data, uint8_t len) {
+  ef_twai_message_t rx = {};
+  rx.identifier = id;
+  rx.extd = true;
+  rx.data_length_code = len;
+  memcpy(rx.data, data, len);
+  canRxEnqueue(*static_cast<BridgeContext *>(arg), rx);
+}
+
+// Queue one request as the inverter frames it; processed at the next drain
+static void request(Rig &r, uint8_t type, uint16_t tracker, uint8_t key, const uint8_t *payload, uint16_t len) {
+  const uint8_t header[MSG14001_HDR_LEN] = {
+    0xAA, 0x03, (uint8_t)len, (uint8_t)(len >> 8), type, 0x2D, key, 0x00,
+    0x00, 0x00, 0x01, 0x4B, 0x14, 0x03, 0x01, 0x01,
+    (uint8_t)(tracker >> 8), (uint8_t)tracker
+  };
+  FrameEncoder enc(MSG14001_START_ID, MSG14001_MID_ID, MSG14001_END_ID, false, enqueueCollect, &r.ctx);
+  enc.write(header, sizeof(header));
+  enc.writeXor(payload, len, key);
+  enc.finish();
+}
+
+// ===== replies =====
+
+static bool expectReplies(const char *what, const Rig &r, const Reply *want, size_t n) {
+  bool ok = r.replies.size() == n;
+  for (size_t i = 0; ok && i < n; i++)
+    ok = r.replies[i].type == want[i].type && r.replies[i].tracker == want[i].tracker &&
+         r.replies[i].key == want[i].key;
+  if (ok) return true;
+  fprintf(stderr, "replies: %s: want", what);
+  for (size_t i = 0; i < n; i++) fprintf(stderr, " %02X/%04X/%02X", want[i].type, want[i].tracker, want[i].key);
+  fprintf(stderr, ", got");
+  for (const Reply &g : r.replies) fprintf(stderr, " %02X/%04X/%02X", g.type, g.tracker, g.key);
+  fprintf(stderr, "\n");
+  return false;
+}
+
+static bool testReplies() {
+  bool ok = true;
+
+  // CB upper then lower limit write in one drain
+  Rig *r = newRig();
+  const uint8_t up = 90, dn = 10;
+  request(*r, 0xCB, 0x2031, 0x11, &up, 1);
+  request(*r, 0xCB, 0x2033, 0x22, &dn, 1);
+  canRxDrain(r->ctx, EF_RX_QUEUE_LEN);
+  const Reply cb[] = {{0xCB, 0x2031, 0x11}, {0xCB, 0x2033, 0x22}};
+  ok &= expectReplies("CB 2031 + CB 2033", *r, cb, 2);
+  if (r->cfg.bmsChgUp != up || r->cfg.bmsChgDn != dn) {
+    fprintf(stderr, "replies: CB limits %u/%u, want %u/%u\n", r->cfg.bmsChgUp, r->cfg.bmsChgDn, up, dn);
+    ok = false;
+  }
+
+  // Two heartbeats, then both DE queries twice
+  Rig *h = newRig();
+  uint8_t c4[69] = {0};
+  memcpy(c4 + 3, "HW51ZEH4SF000001", 16);
+  const uint8_t de[4] = {0x01, 0x00, 0x00, 0x00};
+  request(*h, 0xC4, 0x0302, 0x33, c4, sizeof(c4));
+  request(*h, 0xC4, 0x0302, 0x44, c4, sizeof(c4));
+  request(*h, 0xDE, 0x0105, 0x55, de, sizeof(de));
+  request(*h, 0xDE, 0x0141, 0x66, de, sizeof(de));
+  request(*h, 0xDE, 0x0105, 0x77, de, sizeof(de));
+  request(*h, 0xDE, 0x0141, 0x88, de, sizeof(de));
+  canRxDrain(h->ctx, EF_RX_QUEUE_LEN);
+  const Reply hd[] = {{0x3C, 0x032F, 0x33}, {0x3C, 0x032F, 0x44}, {0x8C, 0x0105, 0x55},
+                      {0x24, 0x0141, 0x66}, {0x8C, 0x0105, 0x77}, {0x24, 0x0141, 0x88}};
+  ok &= expectReplies("C4 x2 + DE x4", *h, hd, sizeof(hd) / sizeof(hd[0]));
+  return ok;
+}
+
+// ===== dispatch =====
+
+static uint32_t g_hitsAny[256], g_hitsExact[256];
+
+static void countHit(BridgeContext &, const RxMessage &, void *arg) {
+  (*static_cast<uint32_t *>(arg))++;
+}
+
+static bool testDispatch() {
+  const uint16_t kTracker = 0x2031;
+  for (int t = 0; t < 256; t++) {
+    if (!rxHandlerRegister((uint8_t)t, RX_TRACKER_ANY, countHit, &g_hitsAny[t]) ||
+        !rxHandlerRegister((uint8_t)t, kTracker, countHit, &g_hitsExact[t])) {
+      fprintf(stderr, "dispatch: handler table full at type %02X (build with -DEF_RX_HANDLERS=1024)\n", t);
+      return false;
+    }
+  }
+
+  // Built-in C4/DE/CB handlers run too, on a bridge of their own
+  Rig *r = newRig();
+  static uint8_t payload[96];
+  bool ok = true;
+  for (int hi = 0x80; hi < 0x100; hi++) {
+    for (int t : {hi & 0x7F, hi}) {
+      memset(g_hitsAny, 0, sizeof(g_hitsAny));
+      memset(g_hitsExact, 0, sizeof(g_hitsExact));
+      for (uint16_t trk : {kTracker, (uint16_t)0x0105}) {
+        uint8_t header[MSG14001_HDR_LEN] = {0xAA, 0x03, sizeof(payload), 0x00, (uint8_t)t};
+        header[IDX_TRK0] = (uint8_t)(trk >> 8);
+        header[IDX_TRK1] = (uint8_t)trk;
+        const RxMessage m = {header, payload, sizeof(payload), (uint8_t)t, 0x5A, trk, 0, 0, 1};
+        rxDispatch(r->ctx, m);
+      }
+      const int twin = t ^ 0x80;
+      if (g_hitsAny[t] != 2 || g_hitsExact[t] != 1 || g_hitsAny[twin] || g_hitsExact[twin]) {
+        fprintf(stderr, "dispatch: type %02X ran any/exact %u/%u, twin %02X ran %u/%u\n", t,
+                (unsigned)g_hitsAny[t], (unsigned)g_hitsExact[t], twin,
+                (unsigned)g_hitsAny[twin], (unsigned)g_hitsExact[twin]);
+        ok = false;
+      }
+    }
+  }
+  return ok;
+}
+
+// ===== Runner =====
+
+struct Test { const char *name; bool (*run)(); };
+
+static const Test kTests[] = {
+  {"replies", testReplies},
+  {"dispatch", testDispatch},
+};
+
+int main() {
+  bool ok = true;
+  for (const Test &t : kTests) {
+    const bool pass = t.run();
+    printf("%-10s %s\n", t.name, pass ? "ok" : "FAIL");
+    ok &= pass;
+  }
+  printf("%s\n", ok ? "PASS" : "FAIL");
+  return ok ? 0 : 1;
+}
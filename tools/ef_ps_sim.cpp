@@ -0,0 +1,477 @@
+// PowerStream simulator: plays the inverter side of the 0x10x14001 protocol
+// against the bridge and checks every reply.
+//
+// Requests, each with a fresh random XOR key, framed like sendCANMessage but
+// by the simulator's own framing and bitwise CRC16 code:
+//   C4             heartbeat carrying the inverter serial  -> 3C
+//   DE 0x0105      query                                   -> 8C 0x0105
+//   DE 0x0141      query                                   -> 24 0x0141 (battery serial)
+//   CB 0x2031/33   upper/lower charge-limit write          -> CB ack, same tracker
+// A reply is correct when its CRC and length are valid, type and tracker
+// match and it is encoded with the request's key. Every other bridge message
+// (the kSeq stream) is reassembled and CRC-checked as well.
+//
+// Loopback (default): the bridge runs in this process on its own
+// BridgeContext; frames go through canRxEnqueue/canRxDrain as on the ESP.
+// SocketCAN (-i IFACE): talk to ef_ps_daemon or an ESP on vcan0/can0.
+//
+// -r N runs all request periods N times faster than a real inverter
+// (1..1000). The bridge's own kSeq timing stays real-time.
+//
+// -f (loopback only) runs on a VirtualClock instead: time jumps straight to
+// the next request or sequencer deadline, so a simulated day (-d 86400)
+// takes seconds and, with -s SEED, every run is identical. Latencies are
+// then simulated time, i.e. 0 unless a reply waits for the sequencer.
+//
+// Build (from the repository root):
+//   g++ -std=gnu++17 -O2 -Icomponents/ef_ps -o ef_ps_sim tools/ef_ps_sim.cpp
+//       $(ls components/ef_ps/*.cpp | grep -v ef_ps.cpp) -lpthread
+
+#include "ecoflow.h"
+#include "bridge_context.h"
+#include "latency_histogram.h"
+#include "socketcan.h"
+#include "clock.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// Nominal inverter behaviour at -r 1
+#ifndef SIM_C4_PERIOD_MS
+#define SIM_C4_PERIOD_MS   500     // heartbeat; the bridge stops after 800 ms without one
+#endif
+#ifndef SIM_DE_PERIOD_MS
+#define SIM_DE_PERIOD_MS   2000    // alternates 0x0105 / 0x0141
+#endif
+#ifndef SIM_CB_PERIOD_MS
+#define SIM_CB_PERIOD_MS   10000   // alternates 0x2031 / 0x2033
+#endif
+#define SIM_REPLY_TIMEOUT_US 200000   // no reply within this → missing (not scaled)
+#define SIM_PENDING          64       // outstanding requests per reply kind
+#define SIM_BURST            4        // loopback: requests per canRxDrain at most
+
+#define SIM_TX_FIRST  0x10014001UL
+#define SIM_TX_MID    0x10114001UL
+#define SIM_TX_LAST   0x10214001UL
+#define BRIDGE_FIRST  0x10003001UL
+#define BRIDGE_MID    0x10103001UL
+#define BRIDGE_LAST   0x10203001UL
+
+// Wire format, written out here instead of taken from the bridge's
+// reassembler, frame encoder, CRC and schema headers: a bug in those must
+// show up as bad replies, not cancel out on both sides.
+#define SIM_HDR_LEN        18
+#define SIM_MAX_PAYLOAD    2048
+#define SIM_BUF_CAP        (SIM_HDR_LEN + SIM_MAX_PAYLOAD + 2)
+#define SIM_IDX_LEN_LO     2
+#define SIM_IDX_LEN_HI     3
+#define SIM_IDX_TYPE       4
+#define SIM_IDX_XOR        6
+#define SIM_IDX_TRK0       16
+#define SIM_IDX_TRK1       17
+#define SIM_24_SERIAL_OFF  8    // battery serial in the 24 payload
+#define SIM_24_SERIAL_LEN  16
+
+// The ESPHome default bridge is not used here
+void sendCANFrame(uint32_t, const uint8_t *, uint8_t) {}
+
+// ===== CRC16 =====
+
+// CRC-16/ARC, bit by bit: poly 0xA001 (reflected 0x8005), init 0, sent LE
+static uint16_t simCrc16(const uint8_t *data, size_t len) {
+  uint16_t crc = 0;
+  for (size_t i = 0; i < len; i++) {
+    crc ^= data[i];
+    for (int b = 0; b < 8; b++) crc = (crc & 1) ? (uint16_t)((crc >> 1) ^ 0xA001) : (uint16_t)(crc >> 1);
+  }
+  return crc;
+}
+
+// ===== Expected replies =====
+
+struct Expect { uint8_t key; uint64_t sentUs; };
+
+struct ReplyCheck {
+  const char *name;
+  uint8_t  type;           // reply msg_type
+  uint16_t tracker;        // reply tracker (BE)
+  Expect   q[SIM_PENDING];
+  uint32_t head, tail;
+
+  uint32_t sent, ok, badKey, badPayload, missing, unsolicited, overflow;
+  LatencyHistogram lat;
+};
+
+static ReplyCheck g_check[TX_REPLY_COUNT] = {
+  {"C4 -> 3C",      0x3C, 0x032F, {}, 0, 0, 0, 0, 0, 0, 0, 0, 0, {}},
+  {"DE 0105 -> 8C", 0x8C, 0x0105, {}, 0, 0, 0, 0, 0, 0, 0, 0, 0, {}},
+  {"DE 0141 -> 24", 0x24, 0x0141, {}, 0, 0, 0, 0, 0, 0, 0, 0, 0, {}},
+  {"CB 2031 ack",   0xCB, 0x2031, {}, 0, 0, 0, 0, 0, 0, 0, 0, 0, {}},
+  {"CB 2033 ack",   0xCB, 0x2033, {}, 0, 0, 0, 0, 0, 0, 0, 0, 0, {}},
+};
+
+static char g_batterySerial[17] = {0};    // expected in 24; empty → not checked
+
+// ===== Bridge stream decoder =====
+
+struct Decoder {
+  uint8_t  buf[SIM_BUF_CAP];
+  size_t   len;
+  bool     active;
+  bool     prefixed;       // 0xA0: first byte of each frame is a length
+
+  uint32_t messages, crcErrors, framingErrors, other;
+  uint32_t perType[256];
+};
+
+static Decoder g_dec = {};
+
+static void onBridgeMessage(const uint8_t *m, size_t total) {
+  const uint8_t type = m[SIM_IDX_TYPE];
+  const uint8_t key  = m[SIM_IDX_XOR];
+  const uint16_t trk = ((uint16_t)m[SIM_IDX_TRK0] << 8) | m[SIM_IDX_TRK1];
+  const uint64_t now = clockNowUs();
+  g_dec.messages++;
+  g_dec.perType[type]++;
+
+  for (uint8_t k = 0; k < TX_REPLY_COUNT; k++) {
+    ReplyCheck &c = g_check[k];
+    if (c.type != type || c.tracker != trk) continue;
+    if (c.head == c.tail) { c.unsolicited++; return; }
+    // Each reply carries its request's key: requests before the matching
+    // one got no reply. No match at all is a wrong key.
+    uint32_t i = c.tail;
+    while (i != c.head && c.q[i % SIM_PENDING].key != key) i++;
+    if (i == c.head) { c.tail++; c.badKey++; return; }
+    c.missing += i - c.tail;
+    const Expect e = c.q[i % SIM_PENDING];
+    c.tail = i + 1;
+
+    bool good = true;
+    if (k == TX_REPLY_24 && g_batterySerial[0]) {
+      const size_t off = SIM_HDR_LEN + SIM_24_SERIAL_OFF;
+      char serial[17] = {0};
+      if (total < off + SIM_24_SERIAL_LEN + 2) good = false;
+      else for (size_t i = 0; i < SIM_24_SERIAL_LEN; i++) serial[i] = (char)(m[off + i] ^ key);
+      if (good && strncmp(serial, g_batterySerial, SIM_24_SERIAL_LEN) != 0) good = false;
+    }
+    if (!good) { c.badPayload++; return; }
+    c.ok++;
+    c.lat.record((uint32_t)(now - e.sentUs));
+    return;
+  }
+}
+
+static void decodeFrame(void *, uint32_t id, const uint8_t *data, uint8_t len) {
+  id &= 0x1FFFFFFF;
+  if (id != BRIDGE_FIRST && id != BRIDGE_MID && id != BRIDGE_LAST) { g_dec.other++; return; }
+  Decoder &d = g_dec;
+
+  if (id == BRIDGE_FIRST) {
+    if (d.active) d.framingErrors++;          // previous message never finished
+    d.active = true;
+    d.len = 0;
+    d.prefixed = len >= 2 && data[0] == len - 1 && data[1] == 0xAA;
+  } else if (!d.active) {
+    d.framingErrors++;
+    return;
+  }
+
+  const uint8_t skip = d.prefixed ? 1 : 0;
+  if (len < skip || d.len + (len - skip) > sizeof(d.buf)) { d.framingErrors++; d.active = false; return; }
+  memcpy(d.buf + d.len, data + skip, len - skip);
+  d.len += len - skip;
+
+  if (d.len < SIM_HDR_LEN) {
+    if (id == BRIDGE_LAST) { d.framingErrors++; d.active = false; }
+    return;
+  }
+  const size_t total = SIM_HDR_LEN + (d.buf[SIM_IDX_LEN_LO] | (d.buf[SIM_IDX_LEN_HI] << 8)) + 2;
+  if (d.buf[0] != 0xAA || total > sizeof(d.buf)) { d.framingErrors++; d.active = false; return; }
+  if (d.len < total) {
+    if (id == BRIDGE_LAST) { d.framingErrors++; d.active = false; }
+    return;
+  }
+  d.active = false;
+  if (d.len != total) { d.framingErrors++; return; }
+
+  const uint16_t crc = (uint16_t)(d.buf[total - 2] | (d.buf[total - 1] << 8));
+  if (simCrc16(d.buf, total - 2) != crc) { d.crcErrors++; return; }
+  onBridgeMessage(d.buf, total);
+}
+
+// ===== Request generator =====
+
+struct Transport {
+  BridgeContext *ctx;      // loopback
+  SocketCanBus  *bus;      // SocketCAN
+  unsigned undrained;      // loopback: requests sent since the last canRxDrain
+};
+
+static void emitRequestFrame(void *arg, uint32_t id, const uint8_t *data, uint8_t len) {
+  Transport &t = *static_cast<Transport *>(arg);
+  if (t.bus) { SocketCanBus::send(t.bus, id, data, len); return; }
+  ef_twai_message_t rx = {};
+  rx.identifier = id;
+  rx.extd = true;
+  rx.data_length_code = len;
+  memcpy(rx.data, data, len);
+  canRxEnqueue(*t.ctx, rx);
+}
+
+static void sendRequest(Transport &t, uint8_t type, uint16_t tracker,
+                        const uint8_t *payload, uint16_t len, uint8_t key) {
+  static uint8_t m[SIM_BUF_CAP];
+  const uint8_t header[SIM_HDR_LEN] = {
+    0xAA, 0x03, (uint8_t)len, (uint8_t)(len >> 8), type, 0x2D, key, 0x00,
+    0x00, 0x00, 0x01, 0x4B, 0x14, 0x03, 0x01, 0x01,
+    (uint8_t)(tracker >> 8), (uint8_t)tracker
+  };
+  memcpy(m, header, SIM_HDR_LEN);
+  for (uint16_t i = 0; i < len; i++) m[SIM_HDR_LEN + i] = payload[i] ^ key;
+  const size_t total = SIM_HDR_LEN + len + 2;
+  const uint16_t crc = simCrc16(m, total - 2);
+  m[total - 2] = (uint8_t)crc;
+  m[total - 1] = (uint8_t)(crc >> 8);
+
+  // A late wake-up sends several requests at once. Up to SIM_BURST of them
+  // share one drain, so same-kind requests do meet in the bridge's queues,
+  // but a real inverter spaces them out and the RX/reply queues don't overflow.
+  if (t.ctx && t.undrained >= SIM_BURST) {
+    canRxDrain(*t.ctx, EF_RX_QUEUE_LEN);
+    t.undrained = 0;
+  }
+  t.undrained++;
+
+  // 8-byte frames: first on SIM_TX_FIRST, last on SIM_TX_LAST, the rest on SIM_TX_MID
+  for (size_t off = 0; off < total; off += 8) {
+    const uint8_t n = (uint8_t)(total - off < 8 ? total - off : 8);
+    const uint32_t id = off == 0 ? SIM_TX_FIRST : (off + n == total ? SIM_TX_LAST : SIM_TX_MID);
+    emitRequestFrame(&t, id, m + off, n);
+  }
+}
+
+static void expectReply(TxReply kind, uint8_t key, uint64_t sentUs) {
+  ReplyCheck &c = g_check[kind];
+  c.sent++;
+  if (c.head - c.tail == SIM_PENDING) { c.tail++; c.overflow++; }   // oldest counted as lost
+  c.q[c.head++ % SIM_PENDING] = {key, sentUs};
+}
+
+static void expireReplies(uint64_t now) {
+  for (uint8_t k = 0; k < TX_REPLY_COUNT; k++) {
+    ReplyCheck &c = g_check[k];
+    while (c.head != c.tail && now - c.q[c.tail % SIM_PENDING].sentUs > SIM_REPLY_TIMEOUT_US) {
+      c.tail++;
+      c.missing++;
+    }
+  }
+}
+
+// ===== Report =====
+
+static void report(double seconds, const BridgeContext *ctx, uint32_t limitErrors,
+                   const VirtualClock *vclock) {
+  if (vclock) printf("%.1f s simulated, %.0fx real time\n", seconds, vclock->ratio());
+  else printf("%.1f s\n", seconds);
+  printf("  %-14s %8s %8s %7s %7s %7s %7s %9s %9s %9s\n",
+         "request", "sent", "ok", "badkey", "badpl", "missing", "unsol", "p50 us", "p99 us", "max us");
+  for (uint8_t k = 0; k < TX_REPLY_COUNT; k++) {
+    const ReplyCheck &c = g_check[k];
+    printf("  %-14s %8u %8u %7u %7u %7u %7u %9u %9u %9u\n", c.name,
+           (unsigned)c.sent, (unsigned)c.ok, (unsigned)c.badKey, (unsigned)c.badPayload,
+           (unsigned)(c.missing + c.overflow), (unsigned)c.unsolicited,
+           (unsigned)c.lat.percentileUs(50), (unsigned)c.lat.percentileUs(99), (unsigned)c.lat.maxUs);
+  }
+  printf("  bridge messages %u (crc errors %u, framing errors %u), foreign frames %u\n",
+         (unsigned)g_dec.messages, (unsigned)g_dec.crcErrors, (unsigned)g_dec.framingErrors,
+         (unsigned)g_dec.other);
+  printf("  by type:");
+  for (int t = 0; t < 256; t++)
+    if (g_dec.perType[t]) printf(" %02X:%u", t, (unsigned)g_dec.perType[t]);
+  printf("\n");
+  if (ctx) {
+    printf("  bridge: rx queue drops %u, reassembly drops %u, timeouts %u, crc errors %u, reply drops %u, limit mismatches %u\n",
+           (unsigned)ctx->metrics.get(MET_RX_QUEUE_DROPS), (unsigned)ctx->metrics.get(MET_RX_REASM_DROPS),
+           (unsigned)ctx->metrics.get(MET_RX_TIMEOUTS), (unsigned)ctx->metrics.get(MET_RX_CRC_ERRORS),
+           (unsigned)ctx->metrics.get(MET_TX_REPLY_DROPS),
+           (unsigned)limitErrors);
+  }
+  fflush(stdout);
+}
+
+static bool replyFailures() {
+  if (g_dec.crcErrors || g_dec.framingErrors) return true;
+  for (uint8_t k = 0; k < TX_REPLY_COUNT; k++) {
+    const ReplyCheck &c = g_check[k];
+    if (c.badKey || c.badPayload || c.missing || c.overflow || c.unsolicited) return true;
+  }
+  return false;
+}
+
+static void usage(const char *argv0) {
+  fprintf(stderr,
+          "usage: %s [-r rate] [-d secs] [-f] [-s seed] [-i iface] [-P serial] [-S serial] [-v secs]\n"
+          "  -r  request rate multiplier, 1..1000 (default 10)\n"
+          "  -d  run time in seconds (default 10)\n"
+          "  -f  fast-forward on virtual time (loopback only)\n"
+          "  -s  random seed (default: time)\n"
+          "  -i  SocketCAN interface; default is an in-process bridge\n"
+          "  -P  inverter serial sent in C4 (default HW51ZEH4SF000001)\n"
+          "  -S  battery serial expected in 24 (loopback default SIMBATTERY000001)\n"
+          "  -v  print the report every N seconds\n",
+          argv0);
+}
+
+int main(int argc, char **argv) {
+  unsigned rate = 10, seconds = 10, statsSec = 0;
+  unsigned seed = (unsigned)time(nullptr);
+  bool fast = false;
+  const char *iface = nullptr;
+  const char *peerSerial = "HW51ZEH4SF000001";
+  const char *batterySerial = nullptr;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "r:d:fs:i:P:S:v:h")) != -1) {
+    switch (opt) {
+      case 'r': rate = (unsigned)atoi(optarg); break;
+      case 'd': seconds = (unsigned)atoi(optarg); break;
+      case 'f': fast = true; break;
+      case 's': seed = (unsigned)strtoul(optarg, nullptr, 0); break;
+      case 'i': iface = optarg; break;
+      case 'P': peerSerial = optarg; break;
+      case 'S': batterySerial = optarg; break;
+      case 'v': statsSec = (unsigned)atoi(optarg); break;
+      default: usage(argv[0]); return 2;
+    }
+  }
+  if (rate < 1 || rate > 1000 || optind != argc || (fast && iface)) { usage(argv[0]); return 2; }
+  srand(seed);
+
+  VirtualClock vclock;
+  if (fast) vclock.install();
+
+  Transport t = {nullptr, nullptr, 0};
+  SocketCanBus bus;
+  EcoflowConfig cfg = {};
+  float inW = 0, outW = 0;
+  BridgeContext *ctx = nullptr;
+
+  if (iface) {
+    if (!bus.open(iface)) { fprintf(stderr, "%s: %s\n", iface, strerror(errno)); return 1; }
+    t.bus = &bus;
+    if (batterySerial) snprintf(g_batterySerial, sizeof(g_batterySerial), "%s", batterySerial);
+  } else {
+    if (!batterySerial) batterySerial = "SIMBATTERY000001";
+    snprintf(g_batterySerial, sizeof(g_batterySerial), "%s", batterySerial);
+    cfg.volt = 5120; cfg.soc = 75; cfg.temp = 25; cfg.chgvolt = 5600;
+    memcpy(cfg.serialStr, g_batterySerial, sizeof(cfg.serialStr));
+    cfg.message70 = cfg.message0B = cfg.message4F = cfg.message68 = cfg.message13 = true;
+    cfg.messageCB = cfg.message5C = cfg.message24 = cfg.message8C = cfg.message3C = true;
+    cfg.canTxEnabled = true;
+    ctx = new BridgeContext();
+    bridgeInit(*ctx, &cfg, &bms, &inW, &outW, decodeFrame, nullptr);
+    t.ctx = ctx;
+  }
+
+  const uint64_t periodC4 = (uint64_t)SIM_C4_PERIOD_MS * 1000u / rate;
+  const uint64_t periodDE = (uint64_t)SIM_DE_PERIOD_MS * 1000u / rate;
+  const uint64_t periodCB = (uint64_t)SIM_CB_PERIOD_MS * 1000u / rate;
+
+  uint8_t c4[69] = {0};
+  memcpy(c4 + 3, peerSerial, strnlen(peerSerial, 16));
+  uint8_t de[4] = {0x01, 0x00, 0x00, 0x00};
+
+  const uint64_t start = clockNowUs();
+  const uint64_t end = start + (uint64_t)seconds * 1000000u;
+  uint64_t nextC4 = start, nextDE = start + periodDE / 2, nextCB = start + periodCB / 3;
+  uint64_t lastStats = start;
+  bool deHigh = false, cbLower = false;
+  uint32_t limitErrors = 0;
+
+  for (uint64_t now = start; now < end; now = clockNowUs()) {
+    // ---- requests due ----
+    while (now >= nextC4) {
+      const uint8_t key = (uint8_t)rand();
+      sendRequest(t, 0xC4, 0x0302, c4, sizeof(c4), key);
+      expectReply(TX_REPLY_3C, key, clockNowUs());
+      nextC4 += periodC4;
+    }
+    while (now >= nextDE) {
+      const uint8_t key = (uint8_t)rand();
+      const uint16_t trk = deHigh ? 0x0141 : 0x0105;
+      sendRequest(t, 0xDE, trk, de, sizeof(de), key);
+      expectReply(deHigh ? TX_REPLY_24 : TX_REPLY_8C, key, clockNowUs());
+      deHigh = !deHigh;
+      nextDE += periodDE;
+    }
+    while (now >= nextCB) {
+      const uint8_t key = (uint8_t)rand();
+      const uint8_t limit = cbLower ? (uint8_t)(5 + rand() % 16) : (uint8_t)(80 + rand() % 21);
+      sendRequest(t, 0xCB, cbLower ? 0x2033 : 0x2031, &limit, 1, key);
+      expectReply(cbLower ? TX_REPLY_CB2033 : TX_REPLY_CB2031, key, clockNowUs());
+      if (ctx) {
+        // the write has to reach config before the ack is sent
+        canRxDrain(*ctx, EF_RX_QUEUE_LEN);
+        t.undrained = 0;
+        if ((cbLower ? cfg.bmsChgDn : cfg.bmsChgUp) != limit) limitErrors++;
+      }
+      cbLower = !cbLower;
+      nextCB += periodCB;
+    }
+
+    // ---- bridge side ----
+    uint64_t wakeUs = nextC4;
+    if (nextDE < wakeUs) wakeUs = nextDE;
+    if (nextCB < wakeUs) wakeUs = nextCB;
+    if (ctx) {
+      canRxDrain(*ctx, EF_RX_QUEUE_LEN);
+      t.undrained = 0;
+      const uint32_t seqMs = canTxSequencerTick(*ctx);
+      canRxTick(*ctx);
+      if (now + (uint64_t)seqMs * 1000u < wakeUs) wakeUs = now + (uint64_t)seqMs * 1000u;
+    } else {
+      bus.flush();
+      if (bus.receive(decodeFrame, nullptr) < 0) { fprintf(stderr, "%s: %s\n", iface, strerror(errno)); return 1; }
+    }
+
+    now = clockNowUs();
+    expireReplies(now);
+    if (statsSec && now - lastStats >= (uint64_t)statsSec * 1000000u) {
+      report((now - start) / 1e6, ctx, limitErrors, fast ? &vclock : nullptr);
+      lastStats = now;
+    }
+
+    // ---- wait for the next request, sequencer step or frame ----
+    if (fast) {
+      vclock.advanceTo(wakeUs);
+    } else if (wakeUs > now) {
+      const uint64_t waitUs = wakeUs - now;
+      if (ctx) {
+        if (waitUs > 50) usleep((useconds_t)((waitUs > 10000) ? 10000 : waitUs - 50));
+      } else {
+        pollfd p = {bus.fd(), (short)(POLLIN | (bus.pending() ? POLLOUT : 0)), 0};
+        poll(&p, 1, (int)((waitUs > 10000) ? 10 : waitUs / 1000));
+      }
+    }
+  }
+
+  // let the last replies arrive
+  for (uint64_t stop = clockNowUs() + SIM_REPLY_TIMEOUT_US; clockNowUs() < stop;) {
+    if (ctx) { canRxDrain(*ctx, EF_RX_QUEUE_LEN); txPumpReplies(*ctx); }
+    else { bus.flush(); bus.receive(decodeFrame, nullptr); }
+    if (fast) vclock.advance(1000);
+    else usleep(1000);
+  }
+  expireReplies(UINT64_MAX);
+
+  report((clockNowUs() - start) / 1e6, ctx, limitErrors, fast ? &vclock : nullptr);
+  const bool failed = replyFailures() || limitErrors;
+  printf("%s\n", failed ? "FAIL" : "PASS");
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,115 @@
+#!/usr/bin/env python3
+"""Compile-size report for the build-time TX message set.
+
+Builds ecoflow.cpp once with every message (the default build) and once per
+message set given on the command line, each through the ef_ps_schedule.h
+that __init__.py generates for `tx_messages`. Prints text/data/bss of
+ecoflow.o, sizeof(BridgeContext) and the kSeq step count for each, and fails
+if a fixed set builds larger than the default.
+
+Run from the repository root:
+  python3 tools/ef_ps_size_report.py                  # 13,CB,24,8C,3C and 3C
+  python3 tools/ef_ps_size_report.py 3C,CB 70,0B,4F   # own sets
+Set CXX / CXXFLAGS to pick the compiler and flags (default g++ -Os).
+"""
+
+import importlib.util
+import os
+import shlex
+import subprocess
+import sys
+import tempfile
+from unittest import mock
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+SRC = os.path.join(ROOT, "components", "ef_ps")
+
+DEFAULT_SETS = ["13,CB,24,8C,3C", "3C"]
+
+PROBE = r"""
+#include "bridge_context.h"
+#include <stdio.h>
+void sendCANFrame(uint32_t, const uint8_t *, uint8_t) {}
+int main() {
+  printf("%zu %zu\n", sizeof(BridgeContext), sizeof(kSeq) / sizeof(kSeq[0]));
+  return 0;
+}
+"""
+
+
+def load_component():
+    """__init__.py without ESPHome installed: only the generator is used."""
+    for name in ["esphome", "esphome.codegen", "esphome.config_validation",
+                 "esphome.components", "esphome.const", "esphome.core",
+                 "esphome.helpers", "esphome.automation", "esphome.final_validate"]:
+        sys.modules.setdefault(name, mock.MagicMock())
+    spec = importlib.util.spec_from_file_location("ef_ps", os.path.join(SRC, "__init__.py"))
+    mod = importlib.util.module_from_spec(spec)
+    spec.loader.exec_module(mod)
+    return mod
+
+
+def run(cmd):
+    res = subprocess.run(cmd, capture_output=True, text=True)
+    if res.returncode != 0:
+        sys.stderr.write(f"{' '.join(cmd)}\n{res.stderr}")
+        sys.exit(1)
+    return res.stdout
+
+
+def measure(cxx, flags, work, schedule_h):
+    """(text, data, bss, sizeof BridgeContext, kSeq steps) for one build."""
+    inc = ["-I" + SRC]
+    if schedule_h is not None:
+        with open(os.path.join(work, "ef_ps_schedule.h"), "w") as f:
+            f.write(schedule_h)
+        inc = ["-DEF_PS_SCHEDULE_H", "-I" + work] + inc
+    obj = os.path.join(work, "ecoflow.o")
+    run([cxx, *flags, *inc, "-c", "-o", obj, os.path.join(SRC, "ecoflow.cpp")])
+    text, data, bss = (int(v) for v in run(["size", obj]).splitlines()[1].split()[:3])
+
+    probe = os.path.join(work, "probe.cpp")
+    with open(probe, "w") as f:
+        f.write(PROBE)
+    exe = os.path.join(work, "probe")
+    others = [os.path.join(SRC, n) for n in sorted(os.listdir(SRC))
+              if n.endswith(".cpp") and n != "ef_ps.cpp"]
+    run([cxx, *flags, *inc, "-o", exe, probe, *others, "-lpthread"])
+    ctx, steps = (int(v) for v in run([exe]).split())
+    return text, data, bss, ctx, steps
+
+
+def main():
+    cxx = os.environ.get("CXX", "g++")
+    flags = ["-std=gnu++17"] + shlex.split(os.environ.get("CXXFLAGS", "-Os"))
+    sets = sys.argv[1:] or DEFAULT_SETS
+    comp = load_component()
+
+    rows = []
+    with tempfile.TemporaryDirectory() as work:
+        rows.append(("all (default)", measure(cxx, flags, work, None)))
+        for s in sets:
+            messages = [m.strip().upper() for m in s.split(",") if m.strip()]
+            bad = [m for m in messages if m not in comp.TX_MESSAGES]
+            if bad:
+                sys.exit(f"unknown message(s) {', '.join(bad)}; one of {' '.join(comp.TX_MESSAGES)}")
+            header = comp._tx_schedule_header(messages, comp.DEFAULT_TX_SCHEDULE)
+            rows.append((",".join(messages) or "none", measure(cxx, flags, work, header)))
+
+    base = rows[0][1]
+    print(f"ecoflow.o, {cxx} {' '.join(flags)}")
+    print(f"  {'tx_messages':<22} {'text':>7} {'data':>6} {'bss':>6} {'delta':>7} {'ctx B':>7} {'kSeq':>5}")
+    grew = False
+    for name, (text, data, bss, ctx, steps) in rows:
+        delta = (text + data) - (base[0] + base[1])
+        grew |= delta > 0
+        print(f"  {name:<22} {text:>7} {data:>6} {bss:>6} {delta:>+7} {ctx:>7} {steps:>5}")
+    if grew:
+        print("FAIL: a fixed message set builds larger than the default")
+        return 1
+    print("PASS")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
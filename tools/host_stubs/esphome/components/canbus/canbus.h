@@ -0,0 +1,63 @@
+#pragma once
+
+// Host stand-in for esphome::canbus (see core/component.h). send_data()
+// builds a CanFrame on the stack and hands it to send_message() like the
+// real Canbus; tests derive from it to capture or refuse frames.
+
+#include "esphome/core/component.h"
+#include <stdint.h>
+#include <string.h>
+#include <functional>
+#include <vector>
+
+namespace esphome {
+namespace canbus {
+
+enum Error : uint8_t {
+  ERROR_OK = 0,
+  ERROR_FAIL = 1,
+  ERROR_ALLTXBUSY = 2,
+};
+
+struct CanFrame {
+  bool use_extended_id = false;
+  bool remote_transmission_request = false;
+  uint32_t can_id;
+  uint8_t can_data_length_code = 0;
+  uint8_t data[8] = {0};
+};
+
+class Canbus : public Component {
+ public:
+  using Callback = std::function<void(uint32_t can_id, bool extended_id, bool rtr,
+                                      const std::vector<uint8_t> &data)>;
+
+  Error send_data(uint32_t can_id, bool use_extended_id, bool remote_transmission_request,
+                  const std::vector<uint8_t> &data) {
+    CanFrame frame;
+    frame.use_extended_id = use_extended_id;
+    frame.remote_transmission_request = remote_transmission_request;
+    frame.can_id = can_id;
+    frame.can_data_length_code = (uint8_t)(data.size() > 8 ? 8 : data.size());
+    memcpy(frame.data, data.data(), frame.can_data_length_code);
+    return this->send_message(&frame);
+  }
+  Error send_data(uint32_t can_id, bool use_extended_id, const std::vector<uint8_t> &data) {
+    return this->send_data(can_id, use_extended_id, false, data);
+  }
+
+  void add_callback(Callback cb) { this->callbacks_.push_back(std::move(cb)); }
+
+  // Test side: deliver a received frame to every callback
+  void receive(uint32_t can_id, bool extended_id, const std::vector<uint8_t> &data) {
+    for (auto &cb : this->callbacks_) cb(can_id, extended_id, false, data);
+  }
+
+ protected:
+  virtual Error send_message(CanFrame *frame) = 0;
+
+  std::vector<Callback> callbacks_;
+};
+
+}  // namespace canbus
+}  // namespace esphome
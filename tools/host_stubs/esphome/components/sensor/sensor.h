@@ -0,0 +1,19 @@
+#pragma once
+
+// Host stand-in (see core/component.h)
+
+namespace esphome {
+namespace sensor {
+
+class Sensor {
+ public:
+  void publish_state(float v) { this->state = v; this->has_state_ = true; }
+  bool has_state() const { return this->has_state_; }
+  float state{0};
+
+ protected:
+  bool has_state_{false};
+};
+
+}  // namespace sensor
+}  // namespace esphome
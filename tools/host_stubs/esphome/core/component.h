@@ -0,0 +1,27 @@
+#pragma once
+
+// Host stand-in for the parts of ESPHome the ef_ps component uses, so
+// ef_ps.cpp builds and runs in host tests (tools/ef_ps_alloc_test.cpp).
+
+#include <stdint.h>
+
+namespace esphome {
+
+class Component {
+ public:
+  virtual ~Component() = default;
+  virtual void setup() {}
+  virtual void loop() {}
+  virtual void dump_config() {}
+};
+
+class PollingComponent : public Component {
+ public:
+  virtual void update() = 0;
+  void set_update_interval(uint32_t ms) { this->update_interval_ = ms; }
+
+ protected:
+  uint32_t update_interval_{0};
+};
+
+}  // namespace esphome
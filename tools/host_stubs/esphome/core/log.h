@@ -0,0 +1,27 @@
+#pragma once
+
+// Host stand-in: log calls compile to nothing (see core/component.h)
+
+#define ESPHOME_LOG_LEVEL_NONE 0
+#define ESPHOME_LOG_LEVEL_ERROR 1
+#define ESPHOME_LOG_LEVEL_WARN 2
+#define ESPHOME_LOG_LEVEL_INFO 3
+#define ESPHOME_LOG_LEVEL_CONFIG 4
+#define ESPHOME_LOG_LEVEL_DEBUG 5
+#define ESPHOME_LOG_LEVEL_VERBOSE 6
+#ifndef ESPHOME_LOG_LEVEL
+#define ESPHOME_LOG_LEVEL ESPHOME_LOG_LEVEL_DEBUG
+#endif
+
+namespace esphome {
+// Arguments are still evaluated and type-checked, then dropped
+template<typename... Ts> inline void host_log_discard(const char *, const char *, const Ts &...) {}
+}  // namespace esphome
+
+#define ESP_LOGE(tag, ...) ::esphome::host_log_discard(tag, __VA_ARGS__)
+#define ESP_LOGW(tag, ...) ::esphome::host_log_discard(tag, __VA_ARGS__)
+#define ESP_LOGI(tag, ...) ::esphome::host_log_discard(tag, __VA_ARGS__)
+#define ESP_LOGD(tag, ...) ::esphome::host_log_discard(tag, __VA_ARGS__)
+#define ESP_LOGV(tag, ...) ::esphome::host_log_discard(tag, __VA_ARGS__)
+#define ESP_LOGCONFIG(tag, ...) ::esphome::host_log_discard(tag, __VA_ARGS__)
+#define LOG_SENSOR(prefix, type, obj) ((void)(obj))